@@ -31,7 +31,9 @@
  */
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include "bmp.h"
+#include "cpu.h"
 #define getInt16(ptr) (ptr[0] | ptr[1]<<8); ptr+=2;
 #define getInt32(ptr) (ptr[0] | ptr[1]<<8 | ptr[2]<<16 | ptr[3]<<24); ptr+=4;
 #define getScanlineSize(width,bitsPerPixel) ((width)*(bitsPerPixel)+31)/32 * 4
@@ -39,6 +41,27 @@
 #define BmpInfoHeaderSize 40
 #define XPixelsPerMeter   2834
 #define YPixelsPerMeter   2834
+#define BI_RGB            0   /* < compression: none                                  */
+#define BI_RLE8           1   /* < compression: run-length encoding of 8-bit pixels   */
+#define BI_RLE4           2   /* < compression: run-length encoding of 4-bit pixels   */
+#define MaxRleCount       255 /* < the maximum number of pixels in an RLE run or literal */
+#define min(a,b)          ((a)<(b) ? (a) : (b))
+
+/*
+ * The run detection is compiled for each instruction set using function attributes, so the same
+ * binary includes every tier and the one used is selected at runtime (see cpu.h).
+ * Define DISABLE_SIMD to build only the scalar code.
+ */
+#if !defined(DISABLE_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define USE_X86_SIMD
+#   include <immintrin.h>
+#   define TARGET_generic
+#   define TARGET_sse2 __attribute__((target("sse2")))
+#   define TARGET_avx2 __attribute__((target("avx2")))
+#endif
+
+/** A function returning how many of the `count` pixels are equal to the first one */
+typedef int (*RunLengthFunc)(const Byte *pixels, int count);
 
 
 
@@ -52,21 +75,22 @@ void initBmpHeader(BmpHeader* header,
 {
     const int scanlineSize   = getScanlineSize(width, bitsPerPixel);
     const int colorTableSize = 4 * (1<<bitsPerPixel);
-    const int pixelDataSize  = scanlineSize * height;
+    /* a negative height means a top-down image, the size of the pixel data is the same */
+    const unsigned long pixelDataSize = (unsigned long)scanlineSize * (unsigned long)(height<0 ? -height : height);
     assert( width  >  0 );
     assert( height != 0 );
     assert( bitsPerPixel==1 || bitsPerPixel==4 || bitsPerPixel==8 );
     
     header->fileType        = 0x4D42;
     header->pixelDataOffset = FileHeaderSize + BmpInfoHeaderSize + colorTableSize;
-    header->fileSize        = header->pixelDataOffset + pixelDataSize;
+    header->fileSize        = (unsigned)(header->pixelDataOffset + pixelDataSize);
     header->headerSize      = BmpInfoHeaderSize;
     header->imageWidth      = width;
     header->imageHeight     = height;
     header->planes          = 1;
     header->bitsPerPixel    = bitsPerPixel;
-    header->pixelDataSize   = pixelDataSize;
-    header->compression     = FALSE;
+    header->pixelDataSize   = (unsigned)pixelDataSize;
+    header->compression     = BI_RGB;
     header->totalColors     = 0;
     header->importantColors = 0;
     header->scanlineSize    = scanlineSize;
@@ -74,45 +98,192 @@ void initBmpHeader(BmpHeader* header,
 
 
 /*=================================================================================================================*/
-#pragma mark - > WRITTING TO FILE
+#pragma mark - > WRITTING TO SINK
 
-static int fwriteInt16(unsigned value, FILE *file) {
+static int writeInt16(unsigned value, ByteSink *sink) {
     unsigned char data[2];
     data[0] = (unsigned char)(value   );
     data[1] = (unsigned char)(value>>8);
-    return 2==fwrite(data, 1, 2, file);
+    return writeSinkBytes(sink, data, 2);
 }
 
-static int fwriteInt32(unsigned value, FILE *file) {
+static int writeInt32(unsigned value, ByteSink *sink) {
     unsigned char data[4];
     data[0] = (unsigned char)(value    );
     data[1] = (unsigned char)(value>> 8);
     data[2] = (unsigned char)(value>>16);
     data[3] = (unsigned char)(value>>24);
-    return 4==fwrite(data, 1, 4, file);
+    return writeSinkBytes(sink, data, 4);
 }
 
-static int fwriteData(const void* data, long dataSize, FILE *file) {
-    return dataSize==(long)fwrite(data, 1, dataSize, file);
+static int writeData(const void* data, long dataSize, ByteSink *sink) {
+    return writeSinkBytes(sink, data, dataSize);
 }
 
-static int fwriteBmpHeader(const BmpHeader *header, FILE *file) {
+static int writeBmpHeader(const BmpHeader *header, ByteSink *sink) {
     return
-    fwriteInt16(header->fileType       , file) &&
-    fwriteInt32(header->fileSize       , file) &&
-    fwriteInt32(           0           , file) &&
-    fwriteInt32(header->pixelDataOffset, file) &&
-    fwriteInt32(header->headerSize     , file) &&
-    fwriteInt32(header->imageWidth     , file) &&
-    fwriteInt32(header->imageHeight    , file) &&
-    fwriteInt16(header->planes         , file) &&
-    fwriteInt16(header->bitsPerPixel   , file) &&
-    fwriteInt32(header->compression    , file) &&
-    fwriteInt32(header->pixelDataSize  , file) &&
-    fwriteInt32(XPixelsPerMeter        , file) &&
-    fwriteInt32(YPixelsPerMeter        , file) &&
-    fwriteInt32(header->totalColors    , file) &&
-    fwriteInt32(header->importantColors, file);
+    writeInt16(header->fileType       , sink) &&
+    writeInt32(header->fileSize       , sink) &&
+    writeInt32(           0           , sink) &&
+    writeInt32(header->pixelDataOffset, sink) &&
+    writeInt32(header->headerSize     , sink) &&
+    writeInt32(header->imageWidth     , sink) &&
+    writeInt32(header->imageHeight    , sink) &&
+    writeInt16(header->planes         , sink) &&
+    writeInt16(header->bitsPerPixel   , sink) &&
+    writeInt32(header->compression    , sink) &&
+    writeInt32(header->pixelDataSize  , sink) &&
+    writeInt32(XPixelsPerMeter        , sink) &&
+    writeInt32(YPixelsPerMeter        , sink) &&
+    writeInt32(header->totalColors    , sink) &&
+    writeInt32(header->importantColors, sink);
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > RUN-LENGTH ENCODING
+
+/*
+ * The runs are detected comparing a chunk of pixels against the first one at once,
+ * the first pixel that differs is the lowest zero bit of the comparison mask.
+ */
+#define RUN_STEP_sse2 16
+#define RUN_STEP_avx2 32
+#define RUN_MASK_sse2(p,v) (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(                     \
+        _mm_loadu_si128((const __m128i*)(p)), _mm_set1_epi8((char)(v)))) | 0xFFFF0000u
+#define RUN_MASK_avx2(p,v) (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(               \
+        _mm256_loadu_si256((const __m256i*)(p)), _mm256_set1_epi8((char)(v))))
+
+static int getRunLength_generic(const Byte *pixels, int count) {
+    int i=1;
+    while (i<count && pixels[i]==pixels[0]) { ++i; }
+    return i;
+}
+
+/** Defines the function that measures a run of pixels using the SIMD instructions of a tier */
+#define DEFINE_RUN_LENGTH(tier)                                                               \
+static TARGET_##tier int getRunLength_##tier(const Byte *pixels, int count) {                 \
+    unsigned mask; int i=0;                                                                   \
+    for ( ; i+RUN_STEP_##tier<=count; i+=RUN_STEP_##tier) {                                   \
+        mask = ~(RUN_MASK_##tier(&pixels[i],pixels[0]));                                      \
+        if (mask) { return i + __builtin_ctz(mask); }                                         \
+    }                                                                                         \
+    while (i<count && pixels[i]==pixels[0]) { ++i; }                                          \
+    return i;                                                                                 \
+}
+
+#ifdef USE_X86_SIMD
+DEFINE_RUN_LENGTH(sse2)
+DEFINE_RUN_LENGTH(avx2)
+#endif
+
+/** The run detection function of each instruction set indexed by CpuTier */
+static const RunLengthFunc theRunLengthFuncs[NUMBER_OF_CPU_TIERS] = {
+    getRunLength_generic,
+#ifdef USE_X86_SIMD
+    getRunLength_sse2,
+    getRunLength_avx2
+#else
+    getRunLength_generic,
+    getRunLength_generic
+#endif
+};
+
+/**
+ * Stores a run of pixels with the same value using the RLE "encoded mode"
+ * @param dest          The buffer where the RLE codes will be stored
+ * @param value         The value of the pixels
+ * @param count         The number of pixels in the run
+ * @param bitsPerPixel  The number of bits of each pixel: 4 (RLE4) or 8 (RLE8)
+ * @returns             The position in `dest` after the stored codes
+ */
+static Byte * putRun(Byte *dest, Byte value, int count, int bitsPerPixel) {
+    int n;
+    if (bitsPerPixel==4) { value = (Byte)(value<<4 | (value & 0x0F)); }
+    while (count>0) {
+        n = min(count, MaxRleCount);
+        (*dest++) = (Byte)n;
+        (*dest++) = value;
+        count -= n;
+    }
+    return dest;
+}
+
+/**
+ * Stores a sequence of pixels without runs using the RLE "absolute mode"
+ *
+ * The absolute mode needs at least 3 pixels, the shorter pieces are stored as
+ * runs of one pixel (RLE8) or as a run alternating two pixels (RLE4).
+ * @param dest          The buffer where the RLE codes will be stored
+ * @param pixels        The values of the pixels, one byte per pixel
+ * @param count         The number of pixels to store
+ * @param bitsPerPixel  The number of bits of each pixel: 4 (RLE4) or 8 (RLE8)
+ * @returns             The position in `dest` after the stored codes
+ */
+static Byte * putLiteral(Byte *dest, const Byte *pixels, int count, int bitsPerPixel) {
+    int i, n, size;
+    while (count>0) {
+        n = min(count, MaxRleCount);
+        /* with RLE4 the absolute mode keeps an even number of pixels, some decoders */
+        /* ignore the last pixel of an odd count (the remaining one is stored as a run) */
+        if (n>=3 && bitsPerPixel==4) { n &= ~1; }
+        if (n<3 && bitsPerPixel==4) {
+            (*dest++) = (Byte)n;
+            (*dest++) = (Byte)(pixels[0]<<4 | (n==2 ? pixels[1] & 0x0F : 0));
+        }
+        else if (n<3) {
+            for (i=0; i<n; ++i) { (*dest++) = 1; (*dest++) = pixels[i]; }
+        }
+        else {
+            (*dest++) = 0;
+            (*dest++) = (Byte)n;
+            if (bitsPerPixel==4) {
+                size = (n+1)/2;
+                for (i=0; i<n; i+=2) {
+                    (*dest++) = (Byte)(pixels[i]<<4 | (i+1<n ? pixels[i+1] & 0x0F : 0));
+                }
+            }
+            else {
+                size = n;
+                memcpy(dest, pixels, n); dest+=n;
+            }
+            /* the absolute mode is padded to a 16-bit boundary */
+            if (size & 1) { (*dest++) = 0; }
+        }
+        pixels += n;
+        count  -= n;
+    }
+    return dest;
+}
+
+/**
+ * Encodes a scanline with RLE4 or RLE8 (the line is terminated with the "end of line" code)
+ *
+ * The buffer `dest` must have room for at least `2*width+2` bytes, the size of the worst case.
+ * @param dest          The buffer where the RLE codes will be stored
+ * @param pixels        The values of the pixels of the scanline, one byte per pixel
+ * @param width         The number of pixels in the scanline
+ * @param bitsPerPixel  The number of bits of each pixel: 4 (RLE4) or 8 (RLE8)
+ * @param getRunLength  The function used to detect the runs
+ * @returns             The number of bytes stored in `dest`
+ */
+static long encodeRleLine(Byte *dest, const Byte *pixels, int width, int bitsPerPixel, RunLengthFunc getRunLength) {
+    /* shorter runs are cheaper inside a literal than breaking it */
+    const int minRun = bitsPerPixel==4 ? 4 : 3;
+    Byte *ptr = dest; int x=0, literal=0, run;
+    
+    while (x<width) {
+        run = getRunLength(&pixels[x], width-x);
+        if (run>=minRun) {
+            ptr = putLiteral(ptr, &pixels[literal], x-literal, bitsPerPixel);
+            ptr = putRun(ptr, pixels[x], run, bitsPerPixel);
+            literal = x+run;
+        }
+        x += run;
+    }
+    ptr = putLiteral(ptr, &pixels[literal], x-literal, bitsPerPixel);
+    (*ptr++) = 0; (*ptr++) = 0;
+    return (long)(ptr-dest);
 }
 
 
@@ -166,21 +337,21 @@ Bool fillBmpHeader(BmpHeader *header, const void* data, long dataSize) {
 
 
 /*
-Bool fwriteBmp(const BmpHeader *header,
-               const void      *colorTable, int colorTableSize,
-               const void      *pixelData , int pixelDataSize,
-               FILE *file) {
+Bool writeBmp(const BmpHeader *header,
+              const void      *colorTable, int colorTableSize,
+              const void      *pixelData , int pixelDataSize,
+              ByteSink *sink) {
     
     return
-    fwriteBmpHeader(header, file)                &&
-    fwriteData(colorTable, colorTableSize, file) &&
-    fwriteData(pixelData,  pixelDataSize,  file);
+    writeBmpHeader(header, sink)                &&
+    writeData(colorTable, colorTableSize, sink) &&
+    writeData(pixelData,  pixelDataSize,  sink);
 }
 */
 
 
 /**
- * Writes an image to file using the BMP format
+ * Writes an image to a sink using the BMP format
  * @param width           The width of the image in pixels
  * @param height          The height of the image in pixels
  * @param scanlineSize    The number of bytes from one line of pixels to the next (negative = upside-down image)
@@ -189,17 +360,17 @@ Bool fwriteBmp(const BmpHeader *header,
  * @param colorTableSize  The size of `colorTable` in number of BYTES
  * @param pixelData       An array of values describing each pixel of the image
  * @param pixelDataSize   The size of `pixelData` in number of BYTES
- * @param file            The output file where the image will be written
+ * @param sink            The output sink where the image will be written
  */
-Bool fwriteBmp(int         width,
-               int         height,
-               int         scanlineSize,
-               int         bitsPerPixel,
-               const void* colorTable,
-               int         colorTableSize,
-               const void* pixelData,
-               int         pixelDataSize,
-               FILE*       file)
+Bool writeBmp(int         width,
+              int         height,
+              int         scanlineSize,
+              int         bitsPerPixel,
+              const void* colorTable,
+              int         colorTableSize,
+              const void* pixelData,
+              long        pixelDataSize,
+              ByteSink*   sink)
 {
     BmpHeader header;
     assert( width>0 && height>0 );
@@ -207,7 +378,7 @@ Bool fwriteBmp(int         width,
     assert( bitsPerPixel==1 || bitsPerPixel==8 );
     assert( colorTable!=NULL && colorTableSize>0 );
     assert( pixelData!=NULL && pixelDataSize>0 );
-    assert( file!=NULL );
+    assert( sink!=NULL );
     
     /* handle "upside-down" images */
     if (scanlineSize<0) { scanlineSize=-scanlineSize; }
@@ -220,7 +391,156 @@ Bool fwriteBmp(int         width,
     
     /* write data using bmp format */
     return
-        fwriteBmpHeader(&header, file)               &&
-        fwriteData(colorTable, colorTableSize, file) &&
-        fwriteData(pixelData,  pixelDataSize,  file);
+        writeBmpHeader(&header, sink)               &&
+        writeData(colorTable, colorTableSize, sink) &&
+        writeData(pixelData,  pixelDataSize,  sink);
+}
+
+/**
+ * Writes an image to a sink using the BMP format reading its pixels from a scanline source
+ *
+ * The image is stored "top-down" (negative height in the header), so the scanlines
+ * are written in the same order they are read from the source.
+ * @param source  The source providing the size, the palette and the scanlines of the image
+ * @param sink    The output sink where the image will be written
+ */
+Bool writeBmpFromSource(ScanlineSource *source, ByteSink *sink) {
+    BmpHeader header; const Byte *scanlines; int i, y, numberOfScanlines; Bool ok;
+    assert( source!=NULL );
+    assert( source->width>0 && source->height>0 );
+    assert( source->bitsPerPixel==1 || source->bitsPerPixel==8 );
+    assert( source->colorTable!=NULL && source->colorTableSize>0 );
+    assert( sink!=NULL );
+    
+    initBmpHeader(&header, source->width, -source->height, source->bitsPerPixel);
+    ok = writeBmpHeader(&header, sink) &&
+         writeData(source->colorTable, source->colorTableSize, sink);
+    
+    for (y=0; y<source->height && ok; y+=numberOfScanlines) {
+        scanlines = readScanlines(source, y, &numberOfScanlines);
+        if (!scanlines) { return FALSE; }
+        /* consecutive scanlines with the BMP layout are written at once */
+        if (source->scanlineSize==header.scanlineSize) {
+            ok = writeData(scanlines, (long)numberOfScanlines*header.scanlineSize, sink);
+        }
+        else {
+            assert( numberOfScanlines==1 || source->scanlineSize>=header.scanlineSize );
+            for (i=0; i<numberOfScanlines && ok; ++i) {
+                ok = writeData(&scanlines[(long)i*source->scanlineSize], header.scanlineSize, sink);
+            }
+        }
+    }
+    return ok;
+}
+
+/**
+ * Writes an image to a sink using the BMP format compressed with RLE4 or RLE8
+ *
+ * RLE4 is used when the source has at most 16 colors, RLE8 otherwise. The scanlines are
+ * read in a single pass from top to bottom and encoded in memory, because the RLE formats
+ * only allow "bottom-up" images and the header must contain the size of the encoded data.
+ * @param source          The source providing the size, the palette and the scanlines of the image
+ * @param sink            The output sink where the image will be written
+ * @param out_isTooLarge  Pointer to the variable set to TRUE when the compressed image exceeds the 4GB of the format (it can be NULL)
+ */
+Bool writeRleBmpFromSource(ScanlineSource *source, ByteSink *sink, Bool *out_isTooLarge) {
+    const RunLengthFunc getRunLength = theRunLengthFuncs[getCpuTier()];
+    BmpHeader header; ByteSink encoded; const Byte *scanlines, *pixels;
+    Byte *line, *unpacked; long *offsets, size; int i, x, y, numberOfScanlines, bitsPerPixel, colorTableSize;
+    Bool ok;
+    assert( source!=NULL );
+    assert( source->width>0 && source->height>0 );
+    assert( source->bitsPerPixel==1 || source->bitsPerPixel==8 );
+    assert( source->colorTable!=NULL && source->colorTableSize>0 );
+    assert( sink!=NULL );
+    
+    if (out_isTooLarge) { (*out_isTooLarge) = FALSE; }
+    bitsPerPixel   = source->bitsPerPixel==1 || source->numberOfColors<=16 ? 4 : 8;
+    colorTableSize = min(source->colorTableSize, 4<<bitsPerPixel);
+    line     = malloc(2L*source->width+2);
+    unpacked = source->bitsPerPixel==1 ? malloc(source->width) : NULL;
+    offsets  = malloc(((long)source->height+1) * sizeof(long));
+    ok       = line!=NULL && offsets!=NULL && (unpacked!=NULL || source->bitsPerPixel!=1);
+    if (!ok || !initMemorySink(&encoded)) { free(line); free(unpacked); free(offsets); return FALSE; }
+    
+    /* 1) encode all the scanlines from top to bottom */
+    offsets[0] = 0;
+    for (y=0; y<source->height && ok; y+=numberOfScanlines) {
+        scanlines = readScanlines(source, y, &numberOfScanlines);
+        if (!scanlines) { ok=FALSE; break; }
+        for (i=0; i<numberOfScanlines && ok; ++i) {
+            pixels = &scanlines[(long)i*source->scanlineSize];
+            if (unpacked) {
+                for (x=0; x<source->width; ++x) { unpacked[x] = (Byte)(pixels[x/8]>>(7-x%8) & 1); }
+                pixels = unpacked;
+            }
+            size = encodeRleLine(line, pixels, source->width, bitsPerPixel, getRunLength);
+            ok   = writeSinkBytes(&encoded, line, size);
+            offsets[y+i+1] = offsets[y+i] + size;
+        }
+    }
+    ok = closeSink(&encoded) && ok;
+    /* the header stores 32-bit sizes */
+    if (ok && (double)encoded.size + (FileHeaderSize+BmpInfoHeaderSize+colorTableSize) > 4294967295.0) {
+        if (out_isTooLarge) { (*out_isTooLarge) = TRUE; }
+        ok = FALSE;
+    }
+    
+    /* 2) write the header and the encoded scanlines from bottom to top, */
+    /*    the "end of line" code of the last one is replaced by "end of bitmap" */
+    if (ok) {
+        initBmpHeader(&header, source->width, source->height, bitsPerPixel);
+        header.compression     = bitsPerPixel==4 ? BI_RLE4 : BI_RLE8;
+        header.totalColors     = colorTableSize/4;
+        header.pixelDataOffset = FileHeaderSize + BmpInfoHeaderSize + colorTableSize;
+        header.pixelDataSize   = (unsigned)encoded.size;
+        header.fileSize        = (unsigned)(header.pixelDataOffset + encoded.size);
+        ok = writeBmpHeader(&header, sink) &&
+             writeData(source->colorTable, colorTableSize, sink);
+        for (y=source->height-1; y>0 && ok; --y) {
+            ok = writeData(&encoded.buffer[offsets[y]], offsets[y+1]-offsets[y], sink);
+        }
+        ok = ok &&
+             writeData(encoded.buffer, offsets[1]-2, sink) &&
+             writeInt16(0x0100, sink);
+    }
+    free(encoded.buffer);
+    free(offsets);
+    free(unpacked);
+    free(line);
+    return ok;
+}
+
+/**
+ * Maps an uncompressed BMP file in memory so that an image that needs the whole framebuffer can be drawn directly into it
+ *
+ * The file gets its final size and its header; the color table and the pixel data
+ * (stored "top-down" with the scanline size of the format) are left zero-filled.
+ * Only the thumbnails and the fractional scales are drawn this way, the other images are streamed.
+ * The pages of the mapping stay resident until the file is closed, as the replaced framebuffer would.
+ * @param sink            The sink writing to the BMP file, nothing must have been written to it
+ * @param width           The width of the image in pixels
+ * @param height          The height of the image in pixels
+ * @param bitsPerPixel    The number of bits for each pixel (valid values: 1 or 8)
+ * @param out_colorTable  Pointer to the variable where the address of the color table (4 bytes per color) will be stored
+ * @returns               The address of the pixel data or NULL if the file cannot be mapped
+ */
+Byte * mapBmpFile(ByteSink *sink, int width, int height, int bitsPerPixel, Byte **out_colorTable) {
+    BmpHeader header; ByteSink prefix; Byte *data = NULL;
+    assert( sink!=NULL && out_colorTable!=NULL );
+    assert( width>0 && height>0 );
+    assert( bitsPerPixel==1 || bitsPerPixel==8 );
+    
+    /* the header is composed in memory and then copied to the start of the file */
+    initBmpHeader(&header, width, -height, bitsPerPixel);
+    if (!initMemorySink(&prefix)) { return NULL; }
+    if (writeBmpHeader(&header, &prefix) && closeSink(&prefix)) {
+        data = mapSink(sink, (size_t)header.pixelDataOffset + (size_t)header.scanlineSize * height);
+    }
+    if (data) {
+        memcpy(data, prefix.buffer, prefix.size);
+        (*out_colorTable) = &data[prefix.size];
+    }
+    free(prefix.buffer);
+    return data ? &data[header.pixelDataOffset] : NULL;
 }
@@ -31,8 +31,9 @@
  */
 #ifndef bas2img_bmp_h
 #define bas2img_bmp_h
-#include <stdio.h>
 #include "globals.h"
+#include "scanline.h"
+#include "sink.h"
 
 typedef struct BmpHeader {
     unsigned fileType;
@@ -70,7 +71,7 @@ int getBmpScanlineSize2(int width, int bitsPerPixel);
 Bool fillBmpHeader(BmpHeader *header, const void* data, long dataSize);
 
 /**
- * Writes an image to file using the BMP format
+ * Writes an image to a sink using the BMP format
  * @param width           The width of the image in pixels
  * @param height          The height of the image in pixels
  * @param scanlineSize    The number of bytes from one line of pixels to the next (negative = upside-down image)
@@ -79,16 +80,54 @@ Bool fillBmpHeader(BmpHeader *header, const void* data, long dataSize);
  * @param colorTableSize  The size of `colorTable` in number of BYTES
  * @param pixelData       An array of values describing each pixel of the image
  * @param pixelDataSize   The size of `pixelData` in number of BYTES
- * @param file            The output file where the image will be written
+ * @param sink            The output sink where the image will be written
  */
-Bool fwriteBmp(int         width,
-               int         height,
-               int         scanlineSize,
-               int         bitsPerPixel,
-               const void* colorTable,
-               int         colorTableSize,
-               const void* pixelData,
-               int         pixelDataSize,
-               FILE*       file);
+Bool writeBmp(int         width,
+              int         height,
+              int         scanlineSize,
+              int         bitsPerPixel,
+              const void* colorTable,
+              int         colorTableSize,
+              const void* pixelData,
+              long        pixelDataSize,
+              ByteSink*   sink);
+
+/**
+ * Writes an image to a sink using the BMP format reading its pixels from a scanline source
+ *
+ * The image is stored "top-down", so the scanlines are requested from top to bottom
+ * and the source can produce the image in bands without keeping it entirely in memory.
+ * @param source  The source providing the size, the palette and the scanlines of the image
+ * @param sink    The output sink where the image will be written
+ */
+Bool writeBmpFromSource(ScanlineSource *source, ByteSink *sink);
+
+/**
+ * Writes an image to a sink using the BMP format compressed with RLE4 or RLE8
+ *
+ * RLE4 is used when the source has at most 16 colors (`source->numberOfColors`) and RLE8
+ * otherwise. The scanlines are read in a single pass and the compressed data is kept in
+ * memory until the end, because the RLE formats only allow "bottom-up" images.
+ * @param source          The source providing the size, the palette and the scanlines of the image
+ * @param sink            The output sink where the image will be written
+ * @param out_isTooLarge  Pointer to the variable set to TRUE when the compressed image exceeds the 4GB of the format (it can be NULL)
+ */
+Bool writeRleBmpFromSource(ScanlineSource *source, ByteSink *sink, Bool *out_isTooLarge);
+
+/**
+ * Maps an uncompressed BMP file in memory so that an image that needs the whole framebuffer can be drawn directly into it
+ *
+ * The file gets its final size and its header; the color table and the pixel data
+ * (stored "top-down" with the scanline size of the format) are left zero-filled.
+ * Only the thumbnails and the fractional scales are drawn this way, the other images are streamed.
+ * The pages of the mapping stay resident until the file is closed, as the replaced framebuffer would.
+ * @param sink            The sink writing to the BMP file, nothing must have been written to it
+ * @param width           The width of the image in pixels
+ * @param height          The height of the image in pixels
+ * @param bitsPerPixel    The number of bits for each pixel (valid values: 1 or 8)
+ * @param out_colorTable  Pointer to the variable where the address of the color table (4 bytes per color) will be stored
+ * @returns               The address of the pixel data or NULL if the file cannot be mapped (ex: a pipe)
+ */
+Byte * mapBmpFile(ByteSink *sink, int width, int height, int bitsPerPixel, Byte **out_colorTable);
 
 #endif /* bas2img_bmp_h */
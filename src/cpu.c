@@ -0,0 +1,99 @@
+/**
+ * @file       cpu.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <string.h>
+#include "globals.h"
+#include "cpu.h"
+#if !defined(DISABLE_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define USE_CPUID
+#   include <cpuid.h>
+#endif
+
+static CpuTier theSupportedTier = CPU_GENERIC; /* < the best tier supported by the CPU */
+static CpuTier theSelectedTier  = CPU_GENERIC; /* < the tier used by the kernels        */
+
+static const utf8 *theTierNames[NUMBER_OF_CPU_TIERS] = { "generic", "sse2", "avx2" };
+
+
+/**
+ * Returns the best tier supported by the CPU and the operating system
+ */
+static CpuTier detectCpuTier(void) {
+    CpuTier tier = CPU_GENERIC;
+#ifdef USE_CPUID
+    unsigned eax, ebx, ecx, edx, xcr0lo, xcr0hi;
+    if ( __get_cpuid(1, &eax, &ebx, &ecx, &edx) ) {
+        if (edx & bit_SSE2) { tier = CPU_SSE2; }
+        /* AVX2 also needs the OS saving the YMM registers (OSXSAVE + XCR0 bits 1 and 2) */
+        if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX) && __get_cpuid_max(0,NULL)>=7) {
+            __asm__ __volatile__ ("xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0));
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            if ((xcr0lo & 6)==6 && (ebx & bit_AVX2)) { tier = CPU_AVX2; }
+        }
+    }
+#endif
+    return tier;
+}
+
+/**
+ * Detects the instruction sets supported by the CPU (it must be called once at startup)
+ */
+void initCpuTier(void) {
+    theSupportedTier = detectCpuTier();
+    theSelectedTier  = theSupportedTier;
+}
+
+/**
+ * Forces the kernels to use a specific tier (for testing and benchmarking)
+ *
+ * A tier that the CPU does not support is lowered to the best tier available.
+ * @param name  The name of the tier: "generic", "sse2" or "avx2"
+ * @returns     `FALSE` if the name does not correspond to any tier
+ */
+Bool forceCpuTier(const utf8 *name) {
+    int tier;
+    assert( name!=NULL );
+    for (tier=0; tier<NUMBER_OF_CPU_TIERS; ++tier) {
+        if (strcmp(name,theTierNames[tier])==0) {
+            theSelectedTier = (CpuTier)tier<theSupportedTier ? (CpuTier)tier : theSupportedTier;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * Returns the tier that the kernels must use
+ */
+CpuTier getCpuTier(void) {
+    return theSelectedTier;
+}
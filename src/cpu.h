@@ -0,0 +1,66 @@
+/**
+ * @file       cpu.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_cpu_h
+#define bas2img_cpu_h
+#include "globals.h"
+
+
+/** The instruction sets that the SIMD kernels can use (each tier includes the previous ones) */
+typedef enum CpuTier {
+    CPU_GENERIC = 0,    /* < portable C code only          */
+    CPU_SSE2,           /* < x86 SSE2 (any x86-64 CPU)     */
+    CPU_AVX2,           /* < x86 AVX2 (Haswell and later)  */
+    NUMBER_OF_CPU_TIERS
+} CpuTier;
+
+
+/**
+ * Detects the instruction sets supported by the CPU (it must be called once at startup)
+ */
+void initCpuTier(void);
+
+/**
+ * Forces the kernels to use a specific tier (for testing and benchmarking)
+ *
+ * A tier that the CPU does not support is lowered to the best tier available.
+ * @param name  The name of the tier: "generic", "sse2" or "avx2"
+ * @returns     `FALSE` if the name does not correspond to any tier
+ */
+Bool forceCpuTier(const utf8 *name);
+
+/**
+ * Returns the tier that the kernels must use
+ */
+CpuTier getCpuTier(void);
+
+
+#endif /* bas2img_cpu_h */
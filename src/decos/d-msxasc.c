@@ -31,6 +31,8 @@
  */
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 #include "../globals.h"
 
 #define LF       0x0A  /* line feed             */
@@ -38,6 +40,27 @@
 #define EXTENDED 0x01  /* extended character    */
 #define EOF      0x1A  /* end of file character */
 
+#define STATE_CODE    0  /* < decoding BASIC code (the state at the beginning of each line) */
+#define STATE_NAME    1  /* < decoding the name of a variable                               */
+#define STATE_STRING  2  /* < decoding a string literal                                     */
+#define STATE_COMMENT 3  /* < decoding a comment (REM or ')                                 */
+
+/** All MSX-BASIC keywords (the interpreter recognizes them even when they aren't separated by spaces) */
+static const char *theKeywords[] = {
+    "ABS","AND","ASC","ATN","ATTR$","AUTO","BASE","BEEP","BIN$","BLOAD","BSAVE","CALL","CDBL","CHR$","CINT",
+    "CIRCLE","CLEAR","CLOAD","CLOSE","CLS","CMD","COLOR","CONT","COPY","COS","CSAVE","CSNG","CSRLIN","CVD","CVI",
+    "CVS","DATA","DEF","DEFDBL","DEFINT","DEFSNG","DEFSTR","DELETE","DIM","DRAW","DSKF","DSKI$","DSKO$","ELSE",
+    "END","EOF","EQV","ERASE","ERL","ERR","ERROR","EXP","FIELD","FILES","FIX","FN","FOR","FPOS","FRE","GET",
+    "GOSUB","GOTO","HEX$","IF","IMP","INKEY$","INP","INPUT","INSTR","INT","INTERVAL","IPL","KEY","KILL","LEFT$",
+    "LEN","LET","LFILES","LINE","LIST","LLIST","LOAD","LOC","LOCATE","LOF","LOG","LPOS","LPRINT","LSET","MAX",
+    "MERGE","MID$","MKD$","MKI$","MKS$","MOD","MOTOR","NAME","NEW","NEXT","NOT","OCT$","OFF","ON","OPEN","OR",
+    "OUT","PAD","PAINT","PDL","PEEK","PLAY","POINT","POKE","POS","PRESET","PRINT","PSET","PUT","READ","REM",
+    "RENUM","RESTORE","RESUME","RETURN","RIGHT$","RND","RSET","RUN","SAVE","SCREEN","SET","SGN","SIN","SOUND",
+    "SPACE$","SPC","SPRITE","SQR","STEP","STICK","STOP","STR$","STRIG","STRING$","SWAP","TAB","TAN","THEN",
+    "TIME","TO","TROFF","TRON","USING","USR","VAL","VARPTR","VDP","VPEEK","VPOKE","WAIT","WIDTH","XOR",
+    NULL
+};
+
 /**
  * Returns TRUE if the provided file content is decodable by this decoder
  * @param sour     The buffer with the first bytes of the file content
@@ -47,20 +70,106 @@ static Bool isDecodable(const Byte *sour, int sourLen) {
     return TRUE;
 }
 
+/**
+ * Returns the longest keyword found at the beginning of the source buffer
+ * @param sour        The source buffer
+ * @param sourLen     The source buffer length in number of bytes
+ * @param out_length  Pointer to the variable where the length of the keyword will be stored
+ * @returns           The keyword found or NULL if the buffer does not start with a keyword
+ */
+static const char * matchKeyword(const Byte *sour, int sourLen, int *out_length) {
+    int i, length; const char *keyword, *bestKeyword=NULL;
+    (*out_length)=0;
+    for (i=0; (keyword=theKeywords[i])!=NULL; ++i) {
+        if (keyword[0]!=toupper(sour[0])) { continue; }
+        for (length=0; keyword[length]!='\0' && length<sourLen && keyword[length]==toupper(sour[length]); ++length) { }
+        if (keyword[length]=='\0' && length>(*out_length)) { (*out_length)=length; bestKeyword=keyword; }
+    }
+    return bestKeyword;
+}
+
+/**
+ * Returns the length of the number found at the beginning of the source buffer
+ * @param sour     The source buffer
+ * @param sourLen  The source buffer length in number of bytes
+ * @returns        The length of the number or zero if the buffer does not start with a number
+ */
+static int matchNumber(const Byte *sour, int sourLen) {
+    int length=0;
+    /* hexadecimal, octal and binary numbers (&H.., &O.., &B..) */
+    if (sour[0]=='&') {
+        if (sourLen<2 || !strchr("HhOoBb",sour[1]) || sour[1]=='\0') { return 0; }
+        length=2; while (length<sourLen && isxdigit(sour[length])) { ++length; }
+        return length;
+    }
+    /* decimal numbers with optional exponent and type suffix (ex: 12, 1.5, .5E-3, 10#) */
+    while (length<sourLen && (isdigit(sour[length]) || sour[length]=='.')) { ++length; }
+    if (length==0 || (length==1 && sour[0]=='.')) { return 0; }
+    if (length+1<sourLen && strchr("EeDd",sour[length]) && sour[length]!='\0') {
+        if      (isdigit(sour[length+1])) { length+=2; }
+        else if (length+2<sourLen && (sour[length+1]=='+' || sour[length+1]=='-') && isdigit(sour[length+2])) { length+=3; }
+        while (length<sourLen && isdigit(sour[length])) { ++length; }
+    }
+    if (length<sourLen && strchr("!#%",sour[length]) && sour[length]!='\0') { ++length; }
+    return length;
+}
+
+/**
+ * Copies the next token from the source buffer classifying its characters
+ * @param dest         The destination buffer where to store the characters
+ * @param attr         The destination buffer where to store the attribute of each character
+ * @param inout_state  Pointer to the lexical state
+ * @param sour         The source buffer (it never starts with LF, CR or EXTENDED)
+ * @param sourLen      The source buffer length in number of bytes (always greater than zero)
+ * @returns            The number of characters copied (always greater than zero)
+ */
+static int decodeToken(Byte *dest, Attr *attr, int *inout_state, const Byte *sour, int sourLen) {
+    int i, length=1, state=(*inout_state); const char *keyword; Attr tokenAttr=ATTR_PLAIN;
+    
+    if (state==STATE_COMMENT) {
+        tokenAttr=ATTR_COMMENT;
+    }
+    else if (state==STATE_STRING) {
+        tokenAttr=ATTR_STRING; if (sour[0]=='"') { state=STATE_CODE; }
+    }
+    else if (sour[0]=='"' ) { tokenAttr=ATTR_STRING;  state=STATE_STRING;  }
+    else if (sour[0]=='\'') { tokenAttr=ATTR_COMMENT; state=STATE_COMMENT; }
+    else if ((keyword=matchKeyword(sour,sourLen,&length))!=NULL) {
+        tokenAttr = ATTR_KEYWORD;
+        state     = strcmp(keyword,"REM")==0 ? STATE_COMMENT : STATE_CODE;
+    }
+    else if (state!=STATE_NAME && (length=matchNumber(sour,sourLen))>0) {
+        tokenAttr=ATTR_NUMBER;
+    }
+    else {
+        length = 1;
+        state  = (isalpha(sour[0]) || (state==STATE_NAME && isdigit(sour[0]))) ? STATE_NAME : STATE_CODE;
+    }
+    for (i=0; i<length; ++i) { dest[i]=sour[i]; attr[i]=tokenAttr; }
+    (*inout_state) = state;
+    return length;
+}
+
 /**
  * Decodes a minimal portion of the data
  *
  * The destination buffer is guaranteed to have space for at least 32 bytes.
  *
  * @param inout_dest   The destination buffer where to store the decoded data.
+ * @param inout_attr   The destination buffer where to store the attribute of each decoded character
+ * @param inout_state  The lexical state preserved between calls (it is zero at the beginning of each line)
  * @param inout_sour   The source buffer with the content to decode
  * @param sourLen      The source buffer length in number of bytes (always greater than zero)
  */
-static Bool decode(Byte **inout_dest, const Byte **inout_sour, int sourLen) {
+static Bool decode(Byte **inout_dest, Attr **inout_attr, int *inout_state, const Byte **inout_sour, int sourLen) {
     Byte       *dest = (*inout_dest);
+    Attr       *attr = (*inout_attr);
     const Byte *sour = (*inout_sour);
     Bool     newline = FALSE;
+    int       length;
     assert( inout_dest!=NULL && (*inout_dest)!=NULL );
+    assert( inout_attr!=NULL && (*inout_attr)!=NULL );
+    assert( inout_state!=NULL );
     assert( inout_sour!=NULL && (*inout_sour)!=NULL );
     assert( sourLen>0 );
     
@@ -68,17 +177,25 @@ static Bool decode(Byte **inout_dest, const Byte **inout_sour, int sourLen) {
     if (sourLen>=2) {
         if      (sour[0]==LF) { sour+=(sour[1]==CR ? 2 : 1); newline=TRUE; }
         else if (sour[0]==CR) { sour+=(sour[1]==LF ? 2 : 1); newline=TRUE; }
-        else if (sour[0]==EXTENDED) { ++sour; *dest++=(*sour++)-0x40; }
-        else                        { *dest++=*sour++; }
+        else if (sour[0]==EXTENDED) {
+            ++sour; *dest++=(*sour++)-0x40;
+            *attr++ = (*inout_state)==STATE_STRING  ? ATTR_STRING  :
+                      (*inout_state)==STATE_COMMENT ? ATTR_COMMENT : ATTR_PLAIN;
+        }
+        else {
+            length = decodeToken(dest, attr, inout_state, sour, sourLen<MIN_DECODE_BUF_SIZE ? sourLen : MIN_DECODE_BUF_SIZE);
+            dest+=length; attr+=length; sour+=length;
+        }
     }
     /* when only left 1 character to decode in the source buffer */
     else {
         if (*sour==EOF || *sour==LF || *sour==CR || *sour==EXTENDED ) { ++sour; }
-        else { *dest++=*sour++; }
+        else { length=decodeToken(dest, attr, inout_state, sour, 1); dest+=length; attr+=length; sour+=length; }
     }
     
     
     (*inout_dest) = dest;
+    (*inout_attr) = attr;
     (*inout_sour) = sour;
     return !newline;
 }
@@ -0,0 +1,220 @@
+/**
+ * @file       diff.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "error.h"
+#include "diff.h"
+#define min(a,b)  ((a)<(b) ? (a) : (b))
+
+/** An entry of the table of unique lines used by Heckel's algorithm */
+typedef struct Symbol {
+    unsigned long   hash;      /* < hash of the characters of the line                 */
+    const SingleRow *row;      /* < the first row found with this content (NULL = free) */
+    int             oldCount;  /* < number of times the line appears in the old version */
+    int             newCount;  /* < number of times the line appears in the new version */
+    int             oldIndex;  /* < index of the line in the old version                */
+} Symbol;
+
+/** The state of the diff between the old and new versions of the listing */
+typedef struct Diff {
+    Symbol       *symbols;     /* < hash table containing one symbol for each different line  */
+    int          tableMask;    /* < size of the hash table minus one (size is a power of 2)  */
+    int          *oldSymbol;   /* < index in the table of the symbol of each old line        */
+    int          *newSymbol;   /* < index in the table of the symbol of each new line        */
+    int          *oldMatch;    /* < the new line matching each old line (-1 = no match)       */
+    int          *newMatch;    /* < the old line matching each new line (-1 = no match)       */
+    SingleRowPtr *rowList;     /* < the rows of the merged listing                           */
+    Byte         *marks;       /* < the DiffMark of each row of the merged listing          */
+    int          numberOfRows; /* < number of rows stored in the merged listing              */
+} Diff;
+
+
+/*=================================================================================================================*/
+#pragma mark - > INTERNAL FUNCTIONS
+
+/**
+ * Returns the hash of the characters contained in a row (FNV-1a)
+ */
+static unsigned long getRowHash(const SingleRow *row) {
+    unsigned long hash = 2166136261UL; int i;
+    assert( row!=NULL );
+    for (i=0; i<row->length; ++i) { hash = ((hash ^ row->chars[i]) * 16777619UL) & 0xFFFFFFFFUL; }
+    return hash;
+}
+
+/**
+ * Returns `TRUE` if both rows contain exactly the same characters
+ */
+static Bool rowsAreEqual(const SingleRow *row1, const SingleRow *row2) {
+    return row1->length==row2->length && memcmp(row1->chars, row2->chars, row1->length)==0;
+}
+
+/**
+ * Returns the index of the symbol that represents the content of the provided row (adding it when necessary)
+ */
+static int getSymbol(Diff *diff, const SingleRow *row) {
+    const unsigned long hash = getRowHash(row);
+    int index = (int)(hash & diff->tableMask);
+    while (diff->symbols[index].row!=NULL) {
+        if (diff->symbols[index].hash==hash && rowsAreEqual(diff->symbols[index].row,row)) { return index; }
+        index = (index+1) & diff->tableMask;
+    }
+    diff->symbols[index].hash = hash;
+    diff->symbols[index].row  = row;
+    return index;
+}
+
+/**
+ * Links an old line with a new line when both are unmatched and have the same content
+ */
+static void matchLines(Diff *diff, int oldIdx, int newIdx) {
+    if (diff->oldMatch[oldIdx]<0 && diff->newMatch[newIdx]<0 &&
+        diff->oldSymbol[oldIdx]==diff->newSymbol[newIdx]) {
+        diff->oldMatch[oldIdx] = newIdx;
+        diff->newMatch[newIdx] = oldIdx;
+    }
+}
+
+/**
+ * Appends a row to the merged listing
+ */
+#define appendRow(diff, row, mark) \
+    ((diff)->rowList[(diff)->numberOfRows]=(row), (diff)->marks[(diff)->numberOfRows++]=(Byte)(mark))
+
+/**
+ * Appends the lines of a gap between two unchanged lines to the merged listing
+ *
+ * The first lines of both versions are paired as changed lines (only the new text is shown),
+ * the remaining ones are shown as removed or added lines.
+ */
+static void appendGap(Diff *diff, const Rows oldRows, int oldBegin, int oldEnd,
+                                  const Rows newRows, int newBegin, int newEnd) {
+    const int numberOfChanges = min(oldEnd-oldBegin, newEnd-newBegin);
+    int i;
+    for (i=0; i<numberOfChanges; ++i) { appendRow(diff, newRows[newBegin++], DIFF_CHANGED); }
+    for (i=oldBegin+numberOfChanges; i<oldEnd; ++i) { appendRow(diff, oldRows[i], DIFF_REMOVED); }
+    for (i=newBegin; i<newEnd; ++i) { appendRow(diff, newRows[i], DIFF_ADDED); }
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > PUBLIC FUNCTIONS
+
+/**
+ * Allocates an array of rows that merges two versions of a listing marking the differences
+ *
+ * The rows are compared as complete text lines (the arrays must not be wrapped) and matched
+ * using Heckel's linear-time algorithm over the hash of each line. The returned array contains
+ * the unchanged rows and the rows of the new version marked as DIFF_ADDED or DIFF_CHANGED,
+ * the rows that only exist in the old version are inserted in place marked as DIFF_REMOVED.
+ * @param oldRows  The rows of the old version of the listing
+ * @param newRows  The rows of the new version of the listing
+ * @returns        The merged array of rows, it must be deallocated with 'freeRows(..)' (NULL on error)
+ */
+Rows allocDiffRows(const Rows oldRows, const Rows newRows) {
+    Diff diff; Symbol *symbol; Rows rows=NULL;
+    int i, j, tableSize, numberOfOld, numberOfNew, oldPos, newPos;
+    assert( oldRows!=NULL && newRows!=NULL );
+    
+    numberOfOld = getNumberOfRows(oldRows);
+    numberOfNew = getNumberOfRows(newRows);
+    tableSize = 16; while (tableSize < 2*(numberOfOld+numberOfNew)) { tableSize*=2; }
+    diff.tableMask    = tableSize-1;
+    diff.numberOfRows = 0;
+    diff.symbols   = calloc(tableSize, sizeof(Symbol));
+    diff.oldSymbol = malloc((numberOfOld+1) * sizeof(int));
+    diff.newSymbol = malloc((numberOfNew+1) * sizeof(int));
+    diff.oldMatch  = malloc((numberOfOld+1) * sizeof(int));
+    diff.newMatch  = malloc((numberOfNew+1) * sizeof(int));
+    diff.rowList   = malloc((numberOfOld+numberOfNew+1) * sizeof(SingleRowPtr));
+    diff.marks     = malloc((numberOfOld+numberOfNew+1) * sizeof(Byte));
+    if (!diff.symbols || !diff.oldSymbol || !diff.newSymbol || !diff.oldMatch || !diff.newMatch ||
+        !diff.rowList || !diff.marks) { error(ERR_NOT_ENOUGH_MEMORY,0); }
+    
+    if (success) {
+        /* 1) count the occurrences of each line in both versions */
+        for (j=0; j<numberOfNew; ++j) {
+            diff.newSymbol[j] = getSymbol(&diff, newRows[j]);
+            diff.newMatch[j]  = -1;
+            ++diff.symbols[ diff.newSymbol[j] ].newCount;
+        }
+        for (i=0; i<numberOfOld; ++i) {
+            diff.oldSymbol[i] = getSymbol(&diff, oldRows[i]);
+            diff.oldMatch[i]  = -1;
+            symbol = &diff.symbols[ diff.oldSymbol[i] ];
+            ++symbol->oldCount; symbol->oldIndex = i;
+        }
+        /* 2) lines that appear exactly once in each version are the anchors of the diff */
+        for (j=0; j<numberOfNew; ++j) {
+            symbol = &diff.symbols[ diff.newSymbol[j] ];
+            if (symbol->oldCount==1 && symbol->newCount==1) { matchLines(&diff, symbol->oldIndex, j); }
+        }
+        /* 3) the first and last lines are matched as if they were preceded and followed by anchors */
+        if (numberOfOld>0 && numberOfNew>0) {
+            matchLines(&diff, 0, 0);
+            matchLines(&diff, numberOfOld-1, numberOfNew-1);
+        }
+        /* 4) extend each match forward and backward over the identical neighbouring lines */
+        for (j=0; j<numberOfNew-1; ++j) {
+            i = diff.newMatch[j];
+            if (i>=0 && i+1<numberOfOld) { matchLines(&diff, i+1, j+1); }
+        }
+        for (j=numberOfNew-1; j>0; --j) {
+            i = diff.newMatch[j];
+            if (i>0) { matchLines(&diff, i-1, j-1); }
+        }
+        /* 5) walk both versions merging the lines in order,
+         *    any match that goes backward (a moved line) is shown as removed + added */
+        oldPos = newPos = 0;
+        for (j=0; j<numberOfNew; ++j) {
+            i = diff.newMatch[j];
+            if (i>=oldPos) {
+                appendGap(&diff, oldRows, oldPos, i, newRows, newPos, j);
+                appendRow(&diff, newRows[j], DIFF_NONE);
+                oldPos = i+1; newPos = j+1;
+            }
+        }
+        appendGap(&diff, oldRows, oldPos, numberOfOld, newRows, newPos, numberOfNew);
+        assert( diff.numberOfRows <= numberOfOld+numberOfNew );
+        rows = allocMarkedRows(diff.rowList, diff.marks, diff.numberOfRows);
+    }
+    free(diff.symbols);
+    free(diff.oldSymbol);
+    free(diff.newSymbol);
+    free(diff.oldMatch);
+    free(diff.newMatch);
+    free(diff.rowList);
+    free(diff.marks);
+    return rows;
+}
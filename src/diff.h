@@ -0,0 +1,52 @@
+/**
+ * @file       diff.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_diff_h
+#define bas2img_diff_h
+#include "globals.h"
+#include "rows.h"
+
+
+/**
+ * Allocates an array of rows that merges two versions of a listing marking the differences
+ *
+ * The rows are compared as complete text lines (the arrays must not be wrapped) and matched
+ * using Heckel's linear-time algorithm over the hash of each line. The returned array contains
+ * the unchanged rows and the rows of the new version marked as DIFF_ADDED or DIFF_CHANGED,
+ * the rows that only exist in the old version are inserted in place marked as DIFF_REMOVED.
+ * @param oldRows  The rows of the old version of the listing
+ * @param newRows  The rows of the new version of the listing
+ * @returns        The merged array of rows, it must be deallocated with 'freeRows(..)' (NULL on error)
+ */
+Rows allocDiffRows(const Rows oldRows, const Rows newRows);
+
+
+#endif /* bas2img_diff_h */
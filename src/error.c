@@ -85,6 +85,7 @@ Bool printErrorMessage(void) {
         case ERR_MISSING_FONT_NAME:    message = "Missing font name. Use the '-list-fonts' option for a list of available fonts."; break;
         case ERR_MISSING_COMPUTER_NAME:message = "Missing computer name. Use the '-list-computers' option for a list of available computers."; break;
         case ERR_INTERNAL_ERROR:       message = "Internal error (?)"; break;
+        case ERR_IMAGE_TOO_LARGE:      message = "the image is too large for the $ format"; break;
         default:                       message = "unknown error"; break;
     }
     if (error->str)  {
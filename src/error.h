@@ -41,7 +41,7 @@ typedef enum ErrorID {
     ERR_GIF_NOT_SUPPORTED, ERR_FILE_IS_NOT_BMP, ERR_BMP_MUST_BE_128PX, ERR_BMP_MUST_BE_1BIT,
     ERR_BMP_UNSUPPORTED_FORMAT, ERR_BMP_INVALID_FORMAT, ERR_NONEXISTENT_FONT, ERR_NONEXISTENT_COMPUTER,
     ERR_MISSING_BAS_PATH, ERR_MISSING_FONTIMG_PATH, ERR_MISSING_FONT_NAME, ERR_MISSING_COMPUTER_NAME,
-    ERR_INTERNAL_ERROR, ERR_INVALID_COMMAND
+    ERR_INTERNAL_ERROR, ERR_INVALID_COMMAND, ERR_IMAGE_TOO_LARGE
 } ErrorID;
 
 typedef struct Error { ErrorID id; const utf8 *str; } Error;
@@ -82,13 +82,13 @@ static void exportFontToImageBuffer(Byte*       buffer,
 
 /**
  * Writes the font image to the provided file using BMP format
- * @param outputFile      The file where the font image will be written
+ * @param sink            The sink where the font image will be written
  * @param outputFilePath  The path to file where the font image will be written (only used for error report)
  * @param imageFormat     The format of the exported image, ex: GIF, BMP, ...
  * @param orientation     The order of characters in the image (vertical slices, horizontal slices)
  * @param font            The font to export
  */
-static Bool exportFontToBmpFile(FILE*        outputFile,
+static Bool exportFontToBmpFile(ByteSink*    sink,
                                 const utf8*  outputFilePath,
                                 ImageFormat  imageFormat,
                                 Orientation  orientation,
@@ -104,17 +104,17 @@ static Bool exportFontToBmpFile(FILE*        outputFile,
         exportFontToImageBuffer(pixelData, pixelDataSize, -scanlineSize, orientation, font);
     }
     if (success && imageFormat==GIF) { /* 2a) write font image buffer into a GIF file */
-        if (!fwriteGif(FONT_IMG_WIDTH, FONT_IMG_HEIGHT, -scanlineSize, FONT_IMG_BITSPERPIXEL,
-                       colorTable, sizeof(colorTable),
-                       pixelData, pixelDataSize,
-                       outputFile))
+        if (!writeGif(FONT_IMG_WIDTH, FONT_IMG_HEIGHT, -scanlineSize, FONT_IMG_BITSPERPIXEL,
+                      colorTable, sizeof(colorTable),
+                      pixelData, pixelDataSize,
+                      sink))
         { error(ERR_CANNOT_WRITE_FILE,outputFilePath); }
     }
     if (success && imageFormat==BMP) { /* 2a) write font image buffer into a BMP file */
-        if (!fwriteBmp(FONT_IMG_WIDTH, FONT_IMG_HEIGHT, -scanlineSize, FONT_IMG_BITSPERPIXEL,
-                       colorTable, sizeof(colorTable),
-                       pixelData, pixelDataSize,
-                       outputFile))
+        if (!writeBmp(FONT_IMG_WIDTH, FONT_IMG_HEIGHT, -scanlineSize, FONT_IMG_BITSPERPIXEL,
+                      colorTable, sizeof(colorTable),
+                      pixelData, pixelDataSize,
+                      sink))
         { error(ERR_CANNOT_WRITE_FILE,outputFilePath); }
     }
     free(pixelData);
@@ -132,7 +132,7 @@ static Bool exportFontToBmpFile(FILE*        outputFile,
  */
 Bool exportFont(const Font *font, ImageFormat imageFormat, Orientation orientation) {
     const utf8 *outputFilePath=NULL, *outputFileName=NULL, *imageExtension;
-    FILE *outputFile=NULL;
+    ByteSink sink; Bool isSinkOpen=FALSE;
     assert( font!=NULL );
     assert( orientation==HORIZONTAL || orientation==VERTICAL );
 
@@ -143,15 +143,15 @@ Bool exportFont(const Font *font, ImageFormat imageFormat, Orientation orientati
         if (!outputFileName || !outputFileName) { error(ERR_NOT_ENOUGH_MEMORY,0); }
     }
     if (success) {
-        outputFile = fopen(outputFilePath, "wb");
-        if (!outputFile) { error(ERR_CANNOT_CREATE_FILE,outputFilePath); }
+        isSinkOpen = openFileSink(&sink, outputFilePath);
+        if (!isSinkOpen) { error(ERR_CANNOT_CREATE_FILE,outputFilePath); }
     }
     if (success) {
         printf("Exporting font %s to file '%s'\n", font->name, outputFilePath);
-        exportFontToBmpFile(outputFile, outputFilePath, imageFormat, orientation, font);
+        exportFontToBmpFile(&sink, outputFilePath, imageFormat, orientation, font);
     }
     /* clean up and return */
-    if (outputFile) { fclose(outputFile); }
+    if (isSinkOpen && !closeSink(&sink) && success) { error(ERR_CANNOT_WRITE_FILE,outputFilePath); }
     free((void*)outputFilePath);
     free((void*)outputFileName);
     return success ? TRUE : FALSE;
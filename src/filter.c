@@ -0,0 +1,154 @@
+/**
+ * @file       filter.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include "filter.h"
+#define ONE     256  /* < the fixed point value of a weight of 1.0 */
+#define HALF    128  /* < used to round fixed point values         */
+#define fixed(value) ((int)((value)*ONE + 0.5))
+
+
+/*=================================================================================================================*/
+#pragma mark - > CREATING THE FILTER
+
+int getResampledSize(int sourceSize, double scale) {
+    double size;
+    assert( sourceSize>0 && scale>0 );
+    size = sourceSize * scale;
+    return (int)size + ( size>(int)size ? 1 : 0 );
+}
+
+Resampler * allocResampler(int sourceSize, double scale) {
+    Resampler *resampler; unsigned short *weights;
+    int i, j, destSize, maxTaps, begin, end, left, right;
+    assert( sourceSize>0 && scale>0 );
+    
+    destSize = getResampledSize(sourceSize, scale);
+    maxTaps  = (int)(1.0/scale) + 2;
+    resampler = malloc(sizeof(Resampler));
+    if (!resampler) { return NULL; }
+    resampler->sourceSize = sourceSize;
+    resampler->destSize   = destSize;
+    resampler->maxTaps    = maxTaps;
+    resampler->first      = malloc(destSize * sizeof(int));
+    resampler->count      = malloc(destSize * sizeof(int));
+    resampler->weights    = calloc(destSize * maxTaps, sizeof(unsigned short));
+    if (!resampler->first || !resampler->count || !resampler->weights) { freeResampler(resampler); return NULL; }
+    
+    /* the destination sample `i` covers the area [i,i+1) and the source sample `j`
+     * covers [j*scale,(j+1)*scale), both measured in destination units (fixed point) */
+    j = 0;
+    for (i=0; i<destSize; ++i) {
+        begin = i*ONE; end = begin+ONE;
+        while (j>0 && fixed((j)*scale)>begin) { --j; }
+        while (j<sourceSize-1 && fixed((j+1)*scale)<=begin) { ++j; }
+        resampler->first[i] = j;
+        resampler->count[i] = 0;
+        weights = &resampler->weights[i*maxTaps];
+        for (; j<sourceSize && fixed(j*scale)<end && resampler->count[i]<maxTaps; ++j) {
+            left  = fixed(j*scale);     if (left <begin) { left =begin; }
+            right = fixed((j+1)*scale); if (right>end  ) { right=end;   }
+            weights[resampler->count[i]++] = (unsigned short)(right>left ? right-left : 0);
+        }
+        if (resampler->count[i]==0) { resampler->first[i]=sourceSize-1; resampler->count[i]=1; }
+        j = resampler->first[i];
+    }
+    return resampler;
+}
+
+void freeResampler(Resampler *resampler) {
+    if (!resampler) { return; }
+    free(resampler->first);
+    free(resampler->count);
+    free(resampler->weights);
+    free(resampler);
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > FILTERING
+
+void resampleLines(Byte            *dest,
+                   const Byte      *source,
+                   int              scanlineSize,
+                   int              width,
+                   const Resampler *resampler,
+                   int              destIndex)
+{
+    const unsigned short *weights; const Byte *line0, *line1; unsigned w0, w1, sum;
+    int x, k, count;
+    assert( dest!=NULL && source!=NULL && resampler!=NULL );
+    assert( 0<=destIndex && destIndex<resampler->destSize );
+    
+    weights = &resampler->weights[destIndex*resampler->maxTaps];
+    count   = resampler->count[destIndex];
+    /* the common cases (one or two lines) are simple loops that compilers can vectorize */
+    if (count==1) {
+        w0 = weights[0];
+        for (x=0; x<width; ++x) { dest[x] = (Byte)((w0*source[x] + HALF) >> 8); }
+    }
+    else if (count==2) {
+        w0 = weights[0]; line0 = source;
+        w1 = weights[1]; line1 = source + scanlineSize;
+        for (x=0; x<width; ++x) { dest[x] = (Byte)((w0*line0[x] + w1*line1[x] + HALF) >> 8); }
+    }
+    else {
+        for (x=0; x<width; ++x) {
+            sum = HALF;
+            for (k=0; k<count; ++k) { sum += weights[k] * source[k*scanlineSize + x]; }
+            dest[x] = (Byte)(sum >> 8);
+        }
+    }
+}
+
+void resampleLine(Byte *dest, const Byte *source, const Resampler *resampler) {
+    const unsigned short *weights; const Byte *samples; unsigned sum;
+    int i, k, count;
+    assert( dest!=NULL && source!=NULL && resampler!=NULL );
+    
+    weights = resampler->weights;
+    /* upscaling: every sample covers one or two source samples (unused weights are zero) */
+    if (resampler->maxTaps==2) {
+        for (i=0; i<resampler->destSize; ++i, weights+=2) {
+            samples = &source[resampler->first[i]];
+            dest[i] = (Byte)((weights[0]*samples[0] + weights[1]*samples[1] + HALF) >> 8);
+        }
+        return;
+    }
+    for (i=0; i<resampler->destSize; ++i, weights+=resampler->maxTaps) {
+        samples = &source[resampler->first[i]];
+        count   = resampler->count[i];
+        sum     = HALF;
+        for (k=0; k<count; ++k) { sum += weights[k] * samples[k]; }
+        dest[i] = (Byte)(sum >> 8);
+    }
+}
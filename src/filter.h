@@ -0,0 +1,99 @@
+/**
+ * @file       filter.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_filter_h
+#define bas2img_filter_h
+#include "globals.h"
+
+
+/**
+ * Precomputed weights to resample a line of samples to a fractional scale (area-averaging filter)
+ *
+ * Each destination sample is the average of the source samples it covers, weighted by the covered
+ * area. Weights are 8-bit fixed point values (256 = 1.0), so a whole line can be filtered with
+ * 16-bit multiply-adds. The same weights are used for both axes of a separable filter.
+ */
+typedef struct Resampler {
+    int  sourceSize;    /* < number of source samples                                          */
+    int  destSize;      /* < number of destination samples                                     */
+    int  maxTaps;       /* < maximum number of source samples covered by one destination sample */
+    int *first;         /* < index of the first source sample covered by each destination sample */
+    int *count;         /* < number of source samples covered by each destination sample         */
+    unsigned short *weights; /* < `maxTaps` weights for each destination sample (their sum is 256) */
+} Resampler;
+
+
+/**
+ * Returns the number of samples resulting from scaling a line of samples (rounded up)
+ * @param sourceSize  The number of source samples
+ * @param scale       The scale factor (it can be fractional)
+ */
+int getResampledSize(int sourceSize, double scale);
+
+/**
+ * Allocates the weights required to resample a line of samples to a fractional scale
+ * @param sourceSize  The number of source samples
+ * @param scale       The scale factor (it can be fractional)
+ * @returns           The new resampler or NULL if there is not enough memory
+ */
+Resampler * allocResampler(int sourceSize, double scale);
+
+/**
+ * Deallocates a resampler previously allocated with 'allocResampler(..)'
+ */
+void freeResampler(Resampler *resampler);
+
+/**
+ * Resamples a group of consecutive lines producing one destination line (vertical pass)
+ * @param dest          The buffer where the `width` filtered samples will be stored
+ * @param source        Pointer to the source line `resampler->first[destIndex]`
+ * @param scanlineSize  The number of bytes from one source line to the next
+ * @param width         The number of samples of each line
+ * @param resampler     The resampler containing the vertical weights
+ * @param destIndex     The index of the destination line to produce
+ */
+void resampleLines(Byte            *dest,
+                   const Byte      *source,
+                   int              scanlineSize,
+                   int              width,
+                   const Resampler *resampler,
+                   int              destIndex);
+
+/**
+ * Resamples the samples of a single line (horizontal pass)
+ * @param dest       The buffer where the `resampler->destSize` filtered samples will be stored
+ * @param source     The line containing `resampler->sourceSize` samples followed by `maxTaps` zeros
+ * @param resampler  The resampler containing the horizontal weights
+ */
+void resampleLine(Byte *dest, const Byte *source, const Resampler *resampler);
+
+
+#endif /* bas2img_filter_h */
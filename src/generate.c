@@ -32,102 +32,1054 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "globals.h"
 #include "helpers.h"
 #include "error.h"
 #include "database.h"
 #include "rows.h"
+#include "diff.h"
 #include "image.h"
+#include "bmp.h"
+#include "gif.h"
+#include "png.h"
+#include "tiff.h"
+#include "svg.h"
+#include "sixel.h"
+#include "glyphs.h"
+#include "threads.h"
+#include "filter.h"
+#include "scanline.h"
 
+#define min(a,b)  ((a)<(b) ? (a) : (b))
 #define NumberOfColors 256
+#define CHARHEIGHT     8   /* < number of bytes used by each character in the font data   */
+#define TEXT_COLOR     7   /* < palette index used to draw plain text                     */
+#define SYNTAX_COLOR0  16  /* < first palette index of the colors used to highlight syntax */
+#define DIFF_COLOR0    24  /* < first palette index of the background colors used to mark a diff */
+#define RAMP_COLOR0    32  /* < first palette index of the ramps used by the filtered (fractional) scaling */
+#define RAMP_LEVELS    8   /* < number of colors of each ramp, from the background to the text color */
+#define NUMBER_OF_MARKS 4  /* < number of values of DiffMark (including DIFF_NONE) */
+#define FRAME_DELAY    8   /* < hundredths of second between two frames of an animation (one row each) */
+#define CHUNK_SIZE (1024L*1024) /* < approximate size of the buffer where the streamed images are drawn (at least one row) */
+#define MIN_BAND_SIZE (64L*1024) /* < minimum size of the pixels drawn by each band (smaller images use less bands) */
 
-static Bool generateImageFromRows(FILE           *outputFile,
-                                  const Rows     rows,
-                                  const Config   *config
-                                  ) {
-    int width, height, charWidth, charHeight;
-    int x,y,i, length;
-    const Char256 *sour;
+/** The palette index of a pixel partially covered by text (one ramp for each combination of background and text colors) */
+#define getRampColor(mark,attr,level) (RAMP_COLOR0 + ((mark)*NUMBER_OF_ATTRS+(attr))*RAMP_LEVELS + (level))
+
+/** The text color of each syntax category */
+static const Rgb theTextColors[NUMBER_OF_ATTRS] = {
+    {255,255,255}, /* < ATTR_PLAIN   : white  */
+    {255,255, 96}, /* < ATTR_KEYWORD : yellow */
+    {128,255,128}, /* < ATTR_STRING  : green  */
+    {255,176, 64}, /* < ATTR_NUMBER  : orange */
+    {176,176,208}  /* < ATTR_COMMENT : gray   */
+};
+
+/** The background color of each row depending on its DiffMark */
+static const Rgb theBackgroundColors[NUMBER_OF_MARKS] = {
+    { 64, 64,255}, /* < DIFF_NONE    : blue       */
+    {  0,128,  0}, /* < DIFF_ADDED   : dark green */
+    {176,  0,  0}, /* < DIFF_REMOVED : dark red   */
+    {160,112,  0}  /* < DIFF_CHANGED : dark amber */
+};
+
+typedef struct PageJob {
+    const utf8   *imageFilePath;   /* < path to the image file where the page will be stored    */
+    Rows          rows;            /* < all rows of the listing (shared by every page)         */
+    int           firstRow;        /* < index of the first row of the page                     */
+    int           numberOfRows;    /* < number of rows in the page                             */
+    int           numberOfColumns; /* < number of characters per row (the same for all pages) */
+    const Config *config;          /* < the configuration used to generate the image           */
+    ErrorID       errorID;         /* < the error produced generating the page (if any)        */
+    const utf8   *errorStr;        /* < the text attached to the error (it can be NULL)        */
+} PageJob;
+
+typedef struct BandJob {
+    Image            image;        /* < copy of the image structure (each band has its own current color) */
+    Rows             rows;         /* < all rows of the listing (shared by every band)          */
+    int              firstRow;     /* < index of the first row of the image                     */
+    int              numberOfRows; /* < number of rows in the image                             */
+    int              bandBegin;    /* < first row (horizontal) or first column (vertical) of the band */
+    int              bandEnd;      /* < the row or the column after the last one of the band    */
+    int              chunkBegin;   /* < the row or the column drawn at the top of `image` (streamed images) */
+    int              charWidth;    /* < width of each character cell in pixels                  */
+    int              charHeight;   /* < height of each character cell in pixels                 */
+    Bool             hasMarks;     /* < TRUE = the rows marked by a diff are drawn over a color */
+    Orientation      orientation;  /* < horizontal or vertical listing                          */
+    const GlyphCache *glyphs;      /* < the glyphs used to draw the characters                  */
+    const int        *attrColors;  /* < the palette index of each character attribute           */
+    const int        *repeated;    /* < the first identical row of each row (NULL = draw every row) */
+    Bool             isCopyPass;   /* < TRUE = copy the repeated rows instead of drawing the others */
+} BandJob;
+
+typedef struct BandStream {
+    BandJob  prototype;       /* < the band job used to draw each chunk, its image is the chunk buffer */
+    int      numberOfThreads; /* < the number of threads used to draw each chunk                 */
+    int      length;          /* < the total number of rows (horizontal) or columns (vertical)   */
+    int      chunkLength;     /* < the number of rows or columns drawn in each chunk             */
+    int      chunkScanlines;  /* < the number of scanlines of each chunk                         */
+    int      currentChunk;    /* < the chunk currently drawn in the buffer (-1 = none)          */
+} BandStream;
+
+
+/**
+ * Draws a single row of text, changing the drawing color only between runs of characters with the same color
+ * @param image       The image where the row will be drawn
+ * @param row         The row of text to draw
+ * @param x           The X coordinate of the first character
+ * @param y           The Y coordinate of the first character
+ * @param stepX       The horizontal distance from one character to the next
+ * @param stepY       The vertical distance from one character to the next
+ * @param glyphs      The glyph cache used to draw the characters
+ * @param attrColors  An array mapping each character attribute to the palette index used to draw it
+ * @param firstChar   The index of the first character of the row to draw
+ * @param endChar     The index after the last character of the row to draw
+ */
+static void drawRow(Image            *image,
+                    const SingleRow  *row,
+                    int x, int y, int stepX, int stepY,
+                    const GlyphCache *glyphs,
+                    const int        *attrColors,
+                    int firstChar, int endChar)
+{
+    int i, end, color;
+    assert( image!=NULL && row!=NULL && glyphs!=NULL && attrColors!=NULL );
+    
+    if (endChar>row->length) { endChar=row->length; }
+    x += firstChar*stepX;
+    y += firstChar*stepY;
+    for (i=firstChar; i<endChar; i=end) {
+        color = attrColors[row->attrs[i]];
+        for (end=i+1; end<endChar && attrColors[row->attrs[end]]==color; ++end) { }
+        setColor(image,color);
+        for ( ; i<end; ++i) {
+            drawGlyph(image,x,y,glyphs,row->chars[i]);
+            x+=stepX; y+=stepY;
+        }
+    }
+}
+
+/**
+ * Draws a band of the image (this function is executed by the worker threads)
+ *
+ * Bands are always ranges of scanlines, so bands never share any byte of the image:
+ * with horizontal orientation a band is a range of rows of text, with vertical orientation
+ * it is a range of columns (characters) of every row of text. The image may hold only
+ * the chunk of the listing that starts at `chunkBegin`.
+ * @param job  Pointer to the `BandJob` structure describing the band to draw
+ */
+static void drawBand(void *job) {
+    BandJob *band = (BandJob*)job; Image *image = &band->image;
+    int i, x, y, originY; size_t bandSize; const SingleRow *row;
+    assert( band!=NULL && band->glyphs!=NULL && band->attrColors!=NULL );
+    
+    if (band->orientation==VERTICAL) {
+        /* vertical: the listing is rotated 90 degrees clockwise, the first row is the rightmost column
+         * of characters and each character is drawn directly from a font with pre-rotated glyphs */
+        x=(band->numberOfRows-1)*band->charHeight; originY=band->chunkBegin*band->charWidth;
+        for (i=band->firstRow; i<(band->firstRow+band->numberOfRows); ++i) {
+            row = band->rows[i];
+            if (band->hasMarks && row->mark!=DIFF_NONE) {
+                setColor(image, DIFF_COLOR0+row->mark);
+                fillRectangle(image, x,band->bandBegin*band->charWidth-originY, x+band->charHeight,band->bandEnd*band->charWidth-originY);
+            }
+            drawRow(image, row, x,-originY, 0,band->charWidth, band->glyphs, band->attrColors, band->bandBegin,band->bandEnd);
+            x-=band->charHeight;
+        }
+    }
+    else {
+        y=(band->bandBegin-band->chunkBegin)*band->charHeight; bandSize=(size_t)band->charHeight*image->scanlineSize;
+        for (i=band->bandBegin; i<band->bandEnd; ++i, y+=band->charHeight) {
+            /* repeated rows are copied (charHeight scanlines) from the first identical row once it is drawn */
+            if (band->repeated && band->repeated[i]!=i) {
+                if (band->isCopyPass) {
+                    memcpy(&image->pixelData[(i-band->chunkBegin)*bandSize],
+                           &image->pixelData[(band->repeated[i]-band->chunkBegin)*bandSize], bandSize);
+                }
+                continue;
+            }
+            if (band->isCopyPass) { continue; }
+            row = band->rows[band->firstRow+i];
+            if (band->hasMarks && row->mark!=DIFF_NONE) {
+                setColor(image, DIFF_COLOR0+row->mark);
+                fillRectangle(image, 0,y, image->width,y+band->charHeight);
+            }
+            drawRow(image, row, 0,y, band->charWidth,0, band->glyphs, band->attrColors, 0,row->length);
+        }
+    }
+}
+
+/**
+ * Draws a range of rows of text splitting it in bands that are drawn in parallel
+ * @param numberOfThreads  The number of threads used to draw the bands (0 = one per processor)
+ * @param prototype        A band job initialized with all the data shared by every band
+ * @param begin            The first row (horizontal) or column (vertical) to draw
+ * @param end              The row or column after the last one to draw
+ *
+ * @returns                `FALSE` if there is not enough memory to prepare the bands
+ *
+ * When the prototype provides the `repeated` rows (horizontal only) each band draws only its unique
+ * rows, then a second pass copies the scanlines of the repeated rows from the rows already drawn.
+ */
+static Bool drawBands(int numberOfThreads, const BandJob *prototype, int begin, int end) {
+    BandJob *bands; int i, numberOfBands, bandLength; const int length = end-begin;
+    size_t imageSize;
+    assert( prototype!=NULL && length>0 );
+    
+    imageSize = (size_t)prototype->image.height * prototype->image.scanlineSize;
+    if (numberOfThreads<=0) { numberOfThreads = getNumberOfProcessors(); }
+    /* a few bands per thread balance the work when some bands contain more text than others, */
+    /* but starting the threads costs more than drawing a few kilobytes of pixels              */
+    numberOfBands = (numberOfThreads>1) ? 4*numberOfThreads : 1;
+    if ((size_t)numberOfBands > imageSize/MIN_BAND_SIZE) { numberOfBands = (int)(imageSize/MIN_BAND_SIZE); }
+    if (numberOfBands>length) { numberOfBands=length; }
+    if (numberOfBands<1     ) { numberOfBands=1;      }
+    bandLength = (length+numberOfBands-1) / numberOfBands;
+    numberOfBands = (length+bandLength-1) / bandLength;
+    
+    bands = malloc(numberOfBands * sizeof(BandJob));
+    if (!bands) { return FALSE; }
+    for (i=0; i<numberOfBands; ++i) {
+        bands[i]           = (*prototype);
+        bands[i].bandBegin = begin + i*bandLength;
+        bands[i].bandEnd   = begin + ((i+1)*bandLength<length ? (i+1)*bandLength : length);
+    }
+    runJobs(drawBand, bands, sizeof(BandJob), numberOfBands, numberOfThreads);
+    /* the repeated rows are copied when every row they depend on has been drawn */
+    if (prototype->repeated) {
+        for (i=0; i<numberOfBands; ++i) { bands[i].isCopyPass = TRUE; }
+        runJobs(drawBand, bands, sizeof(BandJob), numberOfBands, numberOfThreads);
+    }
+    free(bands);
+    return TRUE;
+}
+
+/**
+ * Adapts the indexes of the repeated rows so that each row is only copied from an identical row of its own chunk
+ *
+ * A streamed image keeps only the current chunk in memory, so the first occurrence of each
+ * row inside every chunk is drawn and the following occurrences are copied from it.
+ * @param inout_repeated  Array containing the index of the first identical row of each row
+ * @param numberOfRows    The number of rows in the array
+ * @param chunkLength     The number of rows drawn in each chunk
+ * @returns               The number of rows that still can be copied (0 if there is not enough memory)
+ */
+static int limitRepeatedRowsToChunks(int *inout_repeated, int numberOfRows, int chunkLength) {
+    int i, first, *drawn, numberOfRepeated=0;
+    assert( inout_repeated!=NULL && numberOfRows>0 && chunkLength>0 );
+    
+    /* drawn[first] = the last drawn occurrence of the row `first` */
+    drawn = malloc(numberOfRows * sizeof(int));
+    if (!drawn) { return 0; }
+    for (i=0; i<numberOfRows; ++i) {
+        first = inout_repeated[i];
+        if (first==i || drawn[first] < i-i%chunkLength) { drawn[first] = inout_repeated[i] = i; }
+        else                                           { inout_repeated[i] = drawn[first]; ++numberOfRepeated; }
+    }
+    free(drawn);
+    return numberOfRepeated;
+}
+
+/**
+ * Provides the scanlines of a streamed image drawing the chunk of rows that contains them
+ * (this function is used as the `readScanlines` method of a ScanlineSource)
+ * @param source                 The source whose context is a `BandStream`
+ * @param y                      The index of the first scanline requested
+ * @param out_numberOfScanlines  Pointer to the variable where the number of available scanlines will be stored
+ */
+static const Byte * readStreamedScanlines(ScanlineSource *source, int y, int *out_numberOfScanlines) {
+    BandStream *stream = (BandStream*)source->context; Image *image; int chunk, begin, end;
+    assert( stream!=NULL && out_numberOfScanlines!=NULL );
+    
+    image = &stream->prototype.image;
+    chunk = y / stream->chunkScanlines;
+    if (chunk!=stream->currentChunk) {
+        begin = chunk * stream->chunkLength;
+        end   = min(begin+stream->chunkLength, stream->length);
+        memset(image->pixelData, 0, image->pixelDataSize);
+        stream->prototype.chunkBegin = begin;
+        if (!drawBands(stream->numberOfThreads, &stream->prototype, begin, end)) { return NULL; }
+        stream->currentChunk = chunk;
+    }
+    (*out_numberOfScanlines) = min((chunk+1)*stream->chunkScanlines, source->height) - y;
+    return &image->pixelData[(size_t)(y - chunk*stream->chunkScanlines) * image->scanlineSize];
+}
+
+/**
+ * Computes the palette index that represents the amount of ink of each character of a font
+ *
+ * The index grows with the number of pixels set in the glyph, rounding up so that any
+ * character with ink is distinguishable from a blank one.
+ * @param out_levels  An array of 256 elements where the index of each character will be stored
+ * @param font        The font containing the characters
+ * @param charWidth   The width of each character in pixels (maximum 8)
+ * @param charHeight  The height of each character in pixels (maximum 8)
+ * @param maxLevel    The palette index of a character completely covered by ink (0 = background)
+ */
+static void initCoverageLevels(Byte       *out_levels,
+                               const Font *font,
+                               int         charWidth,
+                               int         charHeight,
+                               int         maxLevel)
+{
+    int charIndex, j, count, area; unsigned segment;
+    assert( out_levels!=NULL && font!=NULL );
+    assert( 0<charWidth  && charWidth <=8 );
+    assert( 0<charHeight && charHeight<=8 );
+    
+    area = charWidth * charHeight;
+    for (charIndex=0; charIndex<256; ++charIndex) {
+        count = 0;
+        for (j=0; j<charHeight; ++j) {
+            segment = font->data[charIndex*CHARHEIGHT+j] & (0xFF00>>charWidth) & 0xFF;
+            while (segment) { segment&=(segment-1); ++count; }
+        }
+        out_levels[charIndex] = (Byte)( (count*maxLevel + area-1) / area );
+    }
+}
+
+/**
+ * Draws a thumbnail of the rows of text where each character cell is a single pixel
+ *
+ * The color of each pixel is taken from the precomputed ink coverage of the character,
+ * highlighted characters keep their syntax color and blank cells of the rows marked
+ * by a diff get the color of the mark.
+ * @param image       The image where the thumbnail will be drawn (one pixel per character)
+ * @param band        A band job describing the rows to draw (glyphs and character sizes are ignored)
+ * @param levels      The palette index representing the ink coverage of each character
+ */
+static void drawThumbnail(Image *image, const BandJob *band, const Byte *levels) {
+    int i, j, x, y, color, background; Byte *ptr; const SingleRow *row;
+    assert( image!=NULL && band!=NULL && levels!=NULL );
+    
+    for (i=0; i<band->numberOfRows; ++i) {
+        row = band->rows[band->firstRow+i];
+        background = (band->hasMarks && row->mark!=DIFF_NONE) ? DIFF_COLOR0+row->mark : 0;
+        /* vertical: the first row is the rightmost column of pixels */
+        if (band->orientation==VERTICAL) { x=band->numberOfRows-1-i; y=0; }
+        else                             { x=0; y=i;                     }
+        if (background) {
+            setColor(image, background);
+            if (band->orientation==VERTICAL) { fillRectangle(image, x,0, x+1,image->height); }
+            else                             { fillRectangle(image, 0,y, image->width,y+1);  }
+        }
+        for (j=0; j<row->length; ++j) {
+            color = levels[row->chars[j]];
+            if (color==0) { continue; }
+            if (band->attrColors[row->attrs[j]]!=TEXT_COLOR && image->bitsPerPixel==8) {
+                color = band->attrColors[row->attrs[j]];
+            }
+            ptr = &image->pixelData[(size_t)y*image->scanlineSize];
+            if (image->bitsPerPixel==1) { ptr[x/8] |= (Byte)(0x80>>(x&7)); }
+            else                        { ptr[x]    = (Byte)color;          }
+            if (band->orientation==VERTICAL) { ++y; } else { ++x; }
+        }
+    }
+}
+
+/**
+ * Calculates the horizontal and vertical magnification requested in the configuration
+ * @param config      The configuration used to generate the image
+ * @param out_scaleX  Pointer to the variable where the horizontal scale will be stored
+ * @param out_scaleY  Pointer to the variable where the vertical scale will be stored
+ * @returns           `TRUE` if the scale can not be drawn with integer pre-scaled glyphs (filtering is required)
+ */
+static Bool getScaleFactors(const Config *config, double *out_scaleX, double *out_scaleY) {
+    double scale;
+    assert( config!=NULL && out_scaleX!=NULL && out_scaleY!=NULL );
+    
+    if      (config->thumbnail          ) { scale = 1.0;                     }
+    else if (config->charScale>0        ) { scale = config->charScale;       }
+    else if (config->fractionalScale>0.0) { scale = config->fractionalScale; }
+    else                                  { scale = 1.0;                     }
+    (*out_scaleY) = scale;
+    (*out_scaleX) = scale;
+    if (config->pixelAspect>0.0 && !config->thumbnail) { (*out_scaleX) *= config->pixelAspect; }
+    return (*out_scaleX)!=(*out_scaleY) || (*out_scaleX)!=(int)(*out_scaleX);
+}
+
+/**
+ * Draws the rows of text with a fractional scale using an area-averaging filter
+ *
+ * The image is processed in bands: the text rows of each band are drawn at 1x into an ink mask
+ * that is filtered vertically and horizontally (separable filter), and the resulting coverage of
+ * each pixel selects a color from the ramp between its background color and its text color.
+ * The filter works in horizontal orientation, vertical images are written transposed.
+ * @param image       The image where the rows will be drawn
+ * @param band        A band job describing the rows to draw, its glyphs must be the 1x horizontal glyphs
+ * @param numberOfColumns  The number of characters that fit in each row of the image
+ * @param fontWidth   The width of each character in pixels (before scaling)
+ * @param fontHeight  The height of each character in pixels (before scaling)
+ * @param scaleX      The horizontal scale
+ * @param scaleY      The vertical scale
+ * @returns           `FALSE` if there is not enough memory to filter the rows
+ */
+static Bool drawFilteredRows(Image *image, const BandJob *band, int numberOfColumns,
+                             int fontWidth, int fontHeight, double scaleX, double scaleY) {
+    Resampler *resamplerX=NULL, *resamplerY=NULL;
+    Image *mask=NULL; Byte *vertical=NULL, *coverage=NULL, *rowColors=NULL; int *columns=NULL;
+    int destY, endY, firstTextRow, endTextRow, i, x, mark, attr, sourceWidth;
+    const SingleRow *row, *prevRow=NULL; Byte *ptr; Bool isDrawn=TRUE;
+    int inkColors[NUMBER_OF_ATTRS]; Byte levels[256];
+    assert( image!=NULL && band!=NULL && band->glyphs!=NULL );
+    assert( scaleX>0 && scaleY>0 );
+    
+    sourceWidth = numberOfColumns * fontWidth;
+    resamplerX = allocResampler(sourceWidth, scaleX);
+    resamplerY = allocResampler(band->numberOfRows*fontHeight, scaleY);
+    if (resamplerX && resamplerY) {
+        vertical  = calloc(sourceWidth + resamplerX->maxTaps, 1);
+        coverage  = malloc(resamplerX->destSize);
+        columns   = malloc(resamplerX->destSize * sizeof(int));
+        rowColors = malloc(numberOfColumns);
+    }
+    if (!vertical || !coverage || !columns || !rowColors) {
+        freeResampler(resamplerX); freeResampler(resamplerY);
+        free(vertical); free(coverage); free(columns); free(rowColors);
+        return FALSE;
+    }
+    /* the character column under the center of each destination pixel (it selects the text color) */
+    for (x=0; x<resamplerX->destSize; ++x) { columns[x] = min((int)((x+0.5)/scaleX)/fontWidth, numberOfColumns-1); }
+    for (i=0; i<NUMBER_OF_ATTRS; ++i) { inkColors[i] = 0xFF; }
+    for (i=0; i<256; ++i) { levels[i] = (Byte)( (i*(RAMP_LEVELS-1) + 0x7F) / 0xFF ); }
+    
+    for (destY=0; destY<resamplerY->destSize && isDrawn; destY=endY) {
+        /* 1) find the text rows needed by the next band of destination scanlines and draw them at 1x */
+        firstTextRow = resamplerY->first[destY] / fontHeight;
+        endTextRow   = firstTextRow;
+        do { endTextRow = min(endTextRow+16, band->numberOfRows); }
+        while (endTextRow<band->numberOfRows &&
+               resamplerY->first[destY]+resamplerY->count[destY] > endTextRow*fontHeight);
+        endY = destY;
+        while (endY<resamplerY->destSize &&
+               resamplerY->first[endY]+resamplerY->count[endY] <= endTextRow*fontHeight) { ++endY; }
+        if (endTextRow==band->numberOfRows) { endY = resamplerY->destSize; }
+        
+        /* the mask is reused by all bands, it only grows when a band needs more text rows */
+        if (!mask || (int)mask->height<(endTextRow-firstTextRow)*fontHeight) {
+            freeImage(mask);
+            mask = allocImageWithDepth(sourceWidth, (endTextRow-firstTextRow)*fontHeight, 8);
+            if (!mask) { isDrawn=FALSE; break; }
+        }
+        else { memset(mask->pixelData, 0, (endTextRow-firstTextRow)*fontHeight*mask->scanlineSize); }
+        for (i=firstTextRow; i<endTextRow; ++i) {
+            row = band->rows[band->firstRow+i];
+            drawRow(mask, row, 0,(i-firstTextRow)*fontHeight, fontWidth,0, band->glyphs, inkColors, 0,row->length);
+        }
+        /* 2) filter each destination scanline and convert its coverage to palette indexes */
+        for (; destY<endY; ++destY) {
+            resampleLines(vertical,
+                          &mask->pixelData[(resamplerY->first[destY]-firstTextRow*fontHeight)*mask->scanlineSize],
+                          mask->scanlineSize, sourceWidth, resamplerY, destY);
+            resampleLine(coverage, vertical, resamplerX);
+            
+            /* the first color of the ramp used by each character of the text row under the scanline */
+            row = band->rows[band->firstRow + min((int)((destY+0.5)/scaleY)/fontHeight, band->numberOfRows-1)];
+            if (row!=prevRow) {
+                mark = band->hasMarks ? row->mark : DIFF_NONE;
+                for (i=0; i<numberOfColumns; ++i) {
+                    attr = (i<row->length && band->attrColors[row->attrs[i]]!=TEXT_COLOR) ? row->attrs[i] : ATTR_PLAIN;
+                    rowColors[i] = (Byte)getRampColor(mark,attr,0);
+                }
+                prevRow = row;
+            }
+            /* vertical: the first scanline is the rightmost column of the image */
+            if (image->bitsPerPixel==1) {
+                for (x=0; x<resamplerX->destSize; ++x) {
+                    if (coverage[x]<0x80) { continue; }
+                    if (band->orientation==VERTICAL) { ptr=&image->pixelData[(size_t)x*image->scanlineSize]; i=image->width-1-destY; }
+                    else                             { ptr=&image->pixelData[(size_t)destY*image->scanlineSize]; i=x; }
+                    ptr[i/8] |= (Byte)(0x80>>(i&7));
+                }
+            }
+            else if (band->orientation==VERTICAL) {
+                ptr = &image->pixelData[image->width-1-destY];
+                for (x=0; x<resamplerX->destSize; ++x, ptr+=image->scanlineSize) {
+                    (*ptr) = (Byte)(rowColors[columns[x]] + levels[coverage[x]]);
+                }
+            }
+            else {
+                ptr = &image->pixelData[(size_t)destY*image->scanlineSize];
+                for (x=0; x<resamplerX->destSize; ++x) { ptr[x] = (Byte)(rowColors[columns[x]] + levels[coverage[x]]); }
+            }
+        }
+    }
+    freeImage(mask);
+    freeResampler(resamplerX); freeResampler(resamplerY);
+    free(vertical); free(coverage); free(columns); free(rowColors);
+    return isDrawn;
+}
+
+/**
+ * Stores an error in the provided structure instead of reporting it
+ * (the images can be generated by worker threads, they can not call `error(..)`)
+ * @param out_error  Pointer to the structure where the error will be stored
+ * @param errorID    The error identifier, ex: ERR_NOT_ENOUGH_MEMORY
+ * @param str        The optional text attached to the error (it must remain valid, it is not copied)
+ * @returns          Always `FALSE`
+ */
+static Bool storeError(Error *out_error, ErrorID errorID, const utf8 *str) {
+    assert( out_error!=NULL );
+    out_error->id  = errorID;
+    out_error->str = str;
+    return FALSE;
+}
+
+/**
+ * Generates a SVG image displaying a range of rows of the source code
+ *
+ * No pixel is drawn, the characters are written as references to the glyphs of the font
+ * and the scale only changes the size of the image (thumbnails are written at 1x).
+ * @param sink             The output sink where the image will be stored
+ * @param rows             The array of rows containing the source code
+ * @param firstRow         The index of the first row to write
+ * @param numberOfRows     The number of rows to write
+ * @param numberOfColumns  The number of characters that fit in each row of the image
+ * @param config           The configuration used to generate the image
+ */
+static Bool generateSvgFromRowRange(ByteSink     *sink,
+                                    const Rows   rows,
+                                    int          firstRow,
+                                    int          numberOfRows,
+                                    int          numberOfColumns,
+                                    const Config *config
+                                    ) {
+    int i, width, height; double scaleX, scaleY;
+    Rgb textColors[NUMBER_OF_ATTRS];
+    Bool hasMarks = FALSE;
+    SvgStyle style;
+    assert( config!=NULL && config->computer!=NULL );
+    
+    for (i=0; i<NUMBER_OF_ATTRS; ++i) {
+        textColors[i] = config->highlighting && !config->monochrome ? theTextColors[i] : theTextColors[ATTR_PLAIN];
+    }
+    for (i=firstRow; i<(firstRow+numberOfRows) && !hasMarks && !config->monochrome; ++i) {
+        hasMarks=(rows[i]->mark!=DIFF_NONE);
+    }
+    getScaleFactors(config, &scaleX, &scaleY);
+    style.font        = config->computer->font;
+    style.fontWidth   = firstPositiveValue(config->charWidth,  config->computer->charWidth,  8);
+    style.fontHeight  = firstPositiveValue(config->charHeight, config->computer->charHeight, 8);
+    width             = getResampledSize(numberOfColumns*style.fontWidth, scaleX);
+    height            = getResampledSize(numberOfRows*style.fontHeight,   scaleY);
+    style.width       = config->orientation==VERTICAL ? height : width;
+    style.height      = config->orientation==VERTICAL ? width  : height;
+    style.orientation = config->orientation;
+    style.background  = theBackgroundColors[DIFF_NONE];
+    style.markColors  = hasMarks ? theBackgroundColors : NULL;
+    style.textColors  = textColors;
+    return writeSvgFromRows(sink, rows, firstRow, numberOfRows, numberOfColumns, &style);
+}
+
+/**
+ * Generates an image displaying a range of rows of the source code
+ *
+ * Images drawn with glyphs (integer scales) are streamed: the encoder pulls the scanlines
+ * and only the chunk of rows that contains them is drawn in memory, so the memory used
+ * does not depend on the length of the listing.
+ * @param sink             The output sink where the image will be stored
+ * @param rows             The array of rows containing the source code
+ * @param firstRow         The index of the first row to draw
+ * @param numberOfRows     The number of rows to draw
+ * @param numberOfColumns  The number of characters that fit in each row of the image
+ * @param numberOfThreads  The number of threads used to draw the image (0 = one per processor)
+ * @param config           The configuration used to generate the image
+ * @param out_error        Pointer to the structure where the error will be stored when the image can not be generated
+ */
+static Bool generateImageFromRowRange(ByteSink     *sink,
+                                      const Rows   rows,
+                                      int          firstRow,
+                                      int          numberOfRows,
+                                      int          numberOfColumns,
+                                      int          numberOfThreads,
+                                      const Config *config,
+                                      Error        *out_error
+                                      ) {
+    int width, height, charWidth, charHeight, fontWidth, fontHeight, scale, mark, attr;
+    int i, imageWidth, imageHeight, chunkUnit;
+    int rowHeight, screenHeight;
+    double scaleX, scaleY; Bool isFiltered, isStreamed, isAnimated, isWritten, isTooLarge=FALSE;
+    Byte *mappedPixels, *mappedColorTable;
+    int *repeated=NULL, numberOfRepeated=0;
+    BandJob prototype;
+    BandStream stream;
+    ScanlineSource source;
+    Byte levels[256];
+    int attrColors[NUMBER_OF_ATTRS];
     const Computer* computer;
     Image *image;
-    const Rgb black = { 0,0,0 };
-    const Rgb blue  = { 64,64,255 };
-    const Rgb white = { 255,255,255 };
-    assert( outputFile!=NULL );
+    Font rotatedFont;
+    const Rgb black  = { 0,0,0 };
+    const Rgb blue   = theBackgroundColors[DIFF_NONE];
+    const Rgb white  = theTextColors[ATTR_PLAIN];
+    Config adjustedConfig;
+    Bool hasMarks = FALSE;
+    int bitsPerPixel;
+    assert( sink!=NULL );
     assert( rows!=NULL );
+    assert( firstRow>=0 && numberOfRows>0 && numberOfColumns>0 );
     assert( config!=NULL && config->computer!=NULL );
-
-    /*
-    for ( i=0 ; lines[i] ; ++i ) {
-        printf("line %d len=%d\n", i,lines[i]->length);
-    }
-    */
+    assert( out_error!=NULL );
     
+    if (config->imageFormat==SVG) {
+        if (!generateSvgFromRowRange(sink, rows, firstRow, numberOfRows, numberOfColumns, config)) {
+            return storeError(out_error, sink->hasFailed ? ERR_CANNOT_WRITE_FILE : ERR_NOT_ENOUGH_MEMORY, 0);
+        }
+        return TRUE;
+    }
+    /* TIFF images are bilevel, they are always rendered in monochrome */
+    if (config->imageFormat==TIFF && !config->monochrome) {
+        adjustedConfig = (*config); adjustedConfig.monochrome = TRUE; config = &adjustedConfig;
+    }
+    /* animations are always horizontal, the rows are added to the screen from top to bottom */
+    isAnimated = config->imageFormat==GIF && config->animationRows>0;
+    if (isAnimated && config->orientation==VERTICAL) {
+        adjustedConfig = (*config); adjustedConfig.orientation = HORIZONTAL; config = &adjustedConfig;
+    }
+    bitsPerPixel = config->monochrome ? 1 : 8;
+
     computer   = config->computer;
-    charWidth  = firstPositiveValue(config->charWidth,  computer->charWidth,  8);
-    charHeight = firstPositiveValue(config->charHeight, computer->charHeight, 8);
-    width      = getMaxRowLength(rows) * charWidth;
-    height     = getNumberOfRows(rows) * charHeight;
-    image      = allocImage(width,height);
+    fontWidth  = firstPositiveValue(config->charWidth,  computer->charWidth,  8);
+    fontHeight = firstPositiveValue(config->charHeight, computer->charHeight, 8);
+    scale      = firstPositiveValue(config->charScale,  1, 1);
+    isFiltered = getScaleFactors(config, &scaleX, &scaleY);
+    charWidth  = config->thumbnail ? 1 : fontWidth  * scale;
+    charHeight = config->thumbnail ? 1 : fontHeight * scale;
+    width      = isFiltered ? getResampledSize(numberOfColumns*fontWidth, scaleX) : numberOfColumns * charWidth;
+    height     = isFiltered ? getResampledSize(numberOfRows*fontHeight,   scaleY) : numberOfRows    * charHeight;
+    rowHeight  = isFiltered ? (int)(fontHeight*scaleY+0.5) : charHeight;
+    if (rowHeight<1) { rowHeight=1; }
+    screenHeight = isAnimated ? min(config->animationRows*rowHeight, height) : height;
+    /* the limits of the file formats: 16-bit dimensions in GIF and 32-bit file size in BMP */
+    /* (the size of the compressed RLE and TIFF images is checked by their writers once encoded) */
+    if (config->imageFormat==GIF && (width>0xFFFF || screenHeight>0xFFFF)) { return storeError(out_error,ERR_IMAGE_TOO_LARGE,"GIF"); }
+    if (config->imageFormat==BMP && !config->rleCompression &&
+        (double)getBmpScanlineSize2(config->orientation==VERTICAL ? height : width, bitsPerPixel) *
+        (config->orientation==VERTICAL ? width : height) + 2048.0 > 4294967295.0) { return storeError(out_error,ERR_IMAGE_TOO_LARGE,"BMP"); }
     
-    setPaletteGradient(image, 0,blue,   7,white);
-    setPaletteGradient(image, 8,white, 15,black);
+    imageWidth  = config->orientation==VERTICAL ? height : width;
+    imageHeight = config->orientation==VERTICAL ? width  : height;
+    isStreamed  = !config->thumbnail && !isFiltered;
+    /* only the thumbnails and the fractional scales need the whole framebuffer, as uncompressed BMP   */
+    /* they are drawn directly into the output file when it can be mapped in memory (the other images */
+    /* are streamed in small chunks, which is faster and uses less memory than the mapping)           */
+    mappedPixels = NULL;
+    if (config->imageFormat==BMP && !config->rleCompression && !isStreamed) {
+        mappedPixels = mapBmpFile(sink, imageWidth, imageHeight, bitsPerPixel, &mappedColorTable);
+    }
+    if (isStreamed) {
+        /* the image buffer only holds a chunk of rows (or columns with vertical orientation) */
+        chunkUnit             = config->orientation==VERTICAL ? charWidth : charHeight;
+        stream.length         = config->orientation==VERTICAL ? numberOfColumns : numberOfRows;
+        stream.chunkLength    = (int)(CHUNK_SIZE / ((long)getBmpScanlineSize2(imageWidth,bitsPerPixel) * chunkUnit));
+        stream.chunkLength    = stream.chunkLength<1 ? 1 : min(stream.chunkLength, stream.length);
+        stream.chunkScanlines = stream.chunkLength * chunkUnit;
+        image = allocImageWithDepth(imageWidth, stream.chunkScanlines, bitsPerPixel);
+    }
+    else if (mappedPixels) { image = allocImageWithPixels(imageWidth, imageHeight, bitsPerPixel, mappedColorTable, mappedPixels); }
+    else { image = allocImageWithDepth(imageWidth, imageHeight, bitsPerPixel); }
+    if (!image) { return storeError(out_error,ERR_NOT_ENOUGH_MEMORY,0); }
+    
+    if (config->monochrome) {
+        /* monochrome: packed 1-bpp pixels, only the background and text colors */
+        setPaletteColor(image, 0, blue );
+        setPaletteColor(image, 1, white);
+    } else {
+        setPaletteGradient(image, 0,blue,   7,white);
+        setPaletteGradient(image, 8,white, 15,black);
+    }
+    if (config->highlighting && !config->monochrome) {
+        for (i=ATTR_PLAIN+1; i<NUMBER_OF_ATTRS; ++i) { setPaletteColor(image, SYNTAX_COLOR0+i, theTextColors[i]); }
+    }
+    for (i=firstRow; i<(firstRow+numberOfRows) && !hasMarks && !config->monochrome; ++i) {
+        hasMarks=(rows[i]->mark!=DIFF_NONE);
+    }
+    if (hasMarks) {
+        for (i=DIFF_NONE+1; i<NUMBER_OF_MARKS; ++i) { setPaletteColor(image, DIFF_COLOR0+i, theBackgroundColors[i]); }
+    }
+    if (isFiltered && !config->monochrome) {
+        for (mark=DIFF_NONE; mark<(hasMarks ? NUMBER_OF_MARKS : DIFF_NONE+1); ++mark) {
+            for (attr=ATTR_PLAIN; attr<(config->highlighting ? NUMBER_OF_ATTRS : ATTR_PLAIN+1); ++attr) {
+                setPaletteGradient(image, getRampColor(mark,attr,0)            , theBackgroundColors[mark],
+                                          getRampColor(mark,attr,RAMP_LEVELS-1), theTextColors[attr]);
+            }
+        }
+    }
 
     /* Draw palette for testing
      x=64; y=64;
      for (i=0; i<=15; ++i,x+=10) { setColor(image,i); fillRectangle(image,x,y,x+10,y+20); }
      */
     
-    setColor(image,7);
-    setFont(image,computer->font);
-    y=0;
-    for (i=0; rows[i]; ++i) {
-        x      = 0;
-        sour   = rows[i]->chars;
-        length = rows[i]->length;
-        while (length-->0) {
-            drawChar(image,x,y,charWidth,charHeight,*sour++);
-            x+=charWidth; }
-        y+=charHeight;
+    /* the color of each syntax category (all plain text when highlighting is disabled) */
+    for (i=0; i<NUMBER_OF_ATTRS; ++i) {
+        if      (config->monochrome                     ) { attrColors[i] = 1;               }
+        else if (config->highlighting && i!=ATTR_PLAIN) { attrColors[i] = SYNTAX_COLOR0+i; }
+        else                                             { attrColors[i] = TEXT_COLOR;      }
+    }
+    
+    prototype.image        = (*image);
+    prototype.rows         = rows;
+    prototype.firstRow     = firstRow;
+    prototype.numberOfRows = numberOfRows;
+    prototype.chunkBegin   = 0;
+    prototype.charWidth    = charWidth;
+    prototype.charHeight   = charHeight;
+    prototype.hasMarks     = hasMarks;
+    prototype.orientation  = config->orientation;
+    prototype.glyphs       = NULL;
+    prototype.attrColors   = attrColors;
+    prototype.repeated     = NULL;
+    prototype.isCopyPass   = FALSE;
+    
+    if (config->thumbnail) {
+        /* thumbnail: each character cell is reduced to a single pixel without rasterizing the glyphs */
+        initCoverageLevels(levels, computer->font, fontWidth, fontHeight, config->monochrome ? 1 : TEXT_COLOR);
+        drawThumbnail(image, &prototype, levels);
+    }
+    else if (isFiltered) {
+        /* fractional scale: the text is drawn at 1x and filtered into the ramps of the palette */
+        prototype.glyphs = allocGlyphCache(computer->font, fontWidth, fontHeight, 1, 8);
+        if (!prototype.glyphs || !drawFilteredRows(image, &prototype, numberOfColumns, fontWidth, fontHeight, scaleX, scaleY)) {
+            freeGlyphCache((GlyphCache*)prototype.glyphs); freeImage(image);
+            return storeError(out_error,ERR_NOT_ENOUGH_MEMORY,0);
+        }
+    }
+    else {
+        if (config->orientation==VERTICAL) {
+            initRotatedFont(&rotatedFont, computer->font, fontWidth, fontHeight);
+            prototype.glyphs = allocGlyphCache(&rotatedFont, fontHeight, fontWidth, scale, bitsPerPixel);
+        } else {
+            prototype.glyphs = allocGlyphCache(computer->font, fontWidth, fontHeight, scale, bitsPerPixel);
+            /* the rows repeated in the listing are drawn only once (without memory all rows are drawn) */
+            repeated = allocRepeatedRowIndexes(rows, firstRow, numberOfRows, &numberOfRepeated);
+            if (numberOfRepeated>0) { numberOfRepeated = limitRepeatedRowsToChunks(repeated, numberOfRows, stream.chunkLength); }
+            if (numberOfRepeated>0) { prototype.repeated = repeated; }
+        }
+        if (!prototype.glyphs) { free(repeated); freeImage(image); return storeError(out_error,ERR_NOT_ENOUGH_MEMORY,0); }
+        stream.prototype       = prototype;
+        stream.numberOfThreads = numberOfThreads;
+        stream.currentChunk    = -1;
+    }
+    
+    if (mappedPixels) {
+        /* the palette and the pixels are already in the file */
+        freeGlyphCache((GlyphCache*)prototype.glyphs);
+        free(repeated);
+        freeImage(image);
+        return TRUE;
     }
     
+    /* the encoders pull the scanlines from the image or, when streamed, from the chunks drawn on demand */
+    initMemoryScanlineSource(&source, imageWidth, imageHeight, image->scanlineSize, bitsPerPixel,
+                             image->colorTable, image->colorTableSize, image->pixelData);
+    if (isStreamed) { source.readScanlines = readStreamedScanlines; source.context = &stream; }
+    /* the highest palette index drawn, it lets PNG store the pixels with fewer bits */
+    source.numberOfColors = TEXT_COLOR+1;
+    if (config->highlighting) { source.numberOfColors = SYNTAX_COLOR0+NUMBER_OF_ATTRS; }
+    if (hasMarks            ) { source.numberOfColors = DIFF_COLOR0+NUMBER_OF_MARKS;   }
+    if (isFiltered          ) { source.numberOfColors = getRampColor(NUMBER_OF_MARKS-1,NUMBER_OF_ATTRS-1,RAMP_LEVELS-1)+1; }
+    if (config->monochrome  ) { source.numberOfColors = 2; }
     switch (config->imageFormat) {
         default:
-        case GIF: fwriteGifImage(image,outputFile); break;
-        case BMP: fwriteBmpImage(image,outputFile); break;
+        case GIF: if (isAnimated) { isWritten = writePagedGifFromSource(&source,screenHeight,rowHeight,FRAME_DELAY,sink); }
+                  else            { isWritten = writeGifFromSource(&source,sink); }
+                  break;
+        case BMP: if (config->rleCompression) { isWritten = writeRleBmpFromSource(&source,sink,&isTooLarge); }
+                  else                        { isWritten = writeBmpFromSource(&source,sink);    }
+                  break;
+        case PNG: isWritten = writePngFromSource(&source,numberOfThreads,sink); break;
+        case TIFF: isWritten = writeTiffFromSource(&source,numberOfThreads,sink,&isTooLarge); break;
+        case SIXEL: isWritten = writeSixelFromSource(&source,sink); break;
     }
+    freeGlyphCache((GlyphCache*)prototype.glyphs);
+    free(repeated);
     freeImage(image);
+    /* the encoders fail when the sink can not be written or when there is not enough memory */
+    if (isTooLarge) { return storeError(out_error,ERR_IMAGE_TOO_LARGE,config->imageFormat==TIFF ? "TIFF" : "BMP"); }
+    if (!isWritten) {
+        return storeError(out_error, sink->hasFailed ? ERR_CANNOT_WRITE_FILE : ERR_NOT_ENOUGH_MEMORY, 0);
+    }
     return TRUE;
 }
 
+/**
+ * Generates an image displaying the source code contained in the provided rows
+ * @param sink        The output sink where the image will be stored
+ * @param rows        The array of rows containing the source code
+ * @param config      The configuration used to generate the image
+ */
+static Bool generateImageFromRows(ByteSink     *sink,
+                                  const Rows   rows,
+                                  const Config *config
+                                  ) {
+    Error imageError = { ERR_NO_ERROR, NULL };
+    assert( sink!=NULL );
+    assert( rows!=NULL );
+    assert( config!=NULL );
+    if (!generateImageFromRowRange(sink, rows, 0, getNumberOfRows(rows), getMaxRowLength(rows),
+                                   config->numberOfThreads, config, &imageError)) {
+        return error(imageError.id, imageError.str);
+    }
+    return TRUE;
+}
+
+/**
+ * Generates the image of a single page (this function is executed by the worker threads)
+ *
+ * The errors are stored in the job and reported by the main thread, the file
+ * of a page that could not be generated is removed.
+ * @param job  Pointer to the `PageJob` structure describing the page to generate
+ */
+static void generatePageImage(void *job) {
+    PageJob *page = (PageJob*)job; ByteSink sink; Bool isGenerated;
+    Error pageError = { ERR_NO_ERROR, NULL };
+    assert( page!=NULL && page->imageFilePath!=NULL );
+    
+    if (!openFileSink(&sink, page->imageFilePath)) {
+        page->errorID  = ERR_CANNOT_CREATE_FILE;
+        page->errorStr = page->imageFilePath;
+        return;
+    }
+    /* the pages are already generated in parallel, so each page is drawn by a single thread */
+    isGenerated = generateImageFromRowRange(&sink, page->rows, page->firstRow, page->numberOfRows,
+                                            page->numberOfColumns, 1, page->config, &pageError);
+    if (!closeSink(&sink) && (isGenerated || pageError.id==ERR_CANNOT_WRITE_FILE)) {
+        isGenerated = storeError(&pageError, ERR_CANNOT_WRITE_FILE, page->imageFilePath);
+    }
+    if (!isGenerated) {
+        removeSinkFile(page->imageFilePath);
+        page->errorID  = pageError.id;
+        page->errorStr = pageError.str;
+    }
+}
+
+/**
+ * Generates one numbered image for each page of the source code contained in the provided rows
+ *
+ * Page boundaries never split a line (unless the line alone is longer than a page),
+ * and all pages are generated in parallel sharing the same array of rows.
+ * @param imageFilePath  The path to the output image, the page number is appended to its name
+ * @param rows           The array of rows containing the source code
+ * @param config         The configuration used to generate the images
+ */
+static Bool generatePagedImagesFromRows(const utf8   *imageFilePath,
+                                        const Rows   rows,
+                                        const Config *config
+                                        ) {
+    PageJob *pages=NULL; int i, firstRow, numberOfRows, numberOfPages=0, numberOfColumns;
+    assert( imageFilePath!=NULL );
+    assert( rows!=NULL );
+    assert( config!=NULL && config->rowsPerPage>0 );
+    
+    /* count the number of pages */
+    firstRow = 0;
+    while ( (numberOfRows=getNumberOfRowsInPage(rows,firstRow,config->rowsPerPage))>0 ) {
+        firstRow+=numberOfRows; ++numberOfPages;
+    }
+    if (numberOfPages==0) { return TRUE; }
+    
+    if (success) { /* 1) prepare the jobs that will generate each page */
+        pages = calloc(numberOfPages, sizeof(PageJob));
+        if (!pages) { error(ERR_NOT_ENOUGH_MEMORY,0); }
+    }
+    if (success) {
+        numberOfColumns = getMaxRowLength(rows);
+        firstRow = 0; for (i=0; i<numberOfPages; ++i) {
+            pages[i].imageFilePath   = allocPageFilePath(imageFilePath, i+1);
+            pages[i].rows            = rows;
+            pages[i].firstRow        = firstRow;
+            pages[i].numberOfRows    = getNumberOfRowsInPage(rows,firstRow,config->rowsPerPage);
+            pages[i].numberOfColumns = numberOfColumns;
+            pages[i].config          = config;
+            pages[i].errorID         = ERR_NO_ERROR;
+            pages[i].errorStr        = NULL;
+            if (!pages[i].imageFilePath) { error(ERR_NOT_ENOUGH_MEMORY,0); break; }
+            firstRow += pages[i].numberOfRows;
+        }
+    }
+    if (success) { /* 2) generate all pages in parallel */
+        runJobs(generatePageImage, pages, sizeof(PageJob), numberOfPages, config->numberOfThreads);
+        for (i=0; i<numberOfPages && success; ++i) {
+            if (pages[i].errorID!=ERR_NO_ERROR) { error(pages[i].errorID, pages[i].errorStr); }
+        }
+    }
+    /* clean up and return */
+    for (i=0; pages && i<numberOfPages; ++i) { free((void*)pages[i].imageFilePath); }
+    free(pages);
+    return success ? TRUE : FALSE;
+}
+
+/**
+ * Rewraps the rows so that the generated image fits the size or the aspect ratio requested in the configuration
+ * @param rows    The array of rows to layout, it is released when a new array is returned
+ * @param config  The configuration used to generate the image
+ * @returns       The array of rows with the new layout (it can be the same provided array)
+ */
+static Rows layoutRowsToFit(Rows rows, const Config *config) {
+    int fitWidth, fitHeight, maxColumns, maxRows, wrapLength;
+    double charWidth, charHeight, scaleX, scaleY, aspectRatio; Rows wrappedRows;
+    assert( rows!=NULL );
+    assert( config!=NULL && config->computer!=NULL );
+    
+    charWidth   = firstPositiveValue(config->charWidth,  config->computer->charWidth,  8);
+    charHeight  = firstPositiveValue(config->charHeight, config->computer->charHeight, 8);
+    getScaleFactors(config, &scaleX, &scaleY);
+    charWidth  *= scaleX;
+    charHeight *= scaleY;
+    if (config->thumbnail) { charWidth = charHeight = 1; }
+    fitWidth    = config->fitWidth;
+    fitHeight   = config->fitHeight;
+    aspectRatio = config->aspectRatio;
+    /* with vertical orientation the rows of text run along the height of the image */
+    if (config->orientation==VERTICAL) {
+        fitWidth    = config->fitHeight;
+        fitHeight   = config->fitWidth;
+        aspectRatio = aspectRatio>0 ? 1.0/aspectRatio : 0.0;
+    }
+    maxColumns = fitWidth >0 ? firstPositiveValue((int)(fitWidth /charWidth ), 1, 0) : 0;
+    maxRows    = fitHeight>0 ? firstPositiveValue((int)(fitHeight/charHeight), 1, 0) : 0;
+    wrapLength = getBestWrapLength(rows, aspectRatio*charHeight/charWidth, maxColumns, maxRows);
+    if (wrapLength<=0 || wrapLength>=getMaxRowLength(rows)) { return rows; }
+    
+    wrappedRows = allocWrappedRows(rows, wrapLength);
+    freeRows(rows);
+    return wrappedRows;
+}
+
+/**
+ * Generates the image (or the paged images) of the listing contained in the provided rows
+ * @param sink            The output sink where the image will be stored (NULL when generating pages)
+ * @param outputFilePath  The path to the output image, used to name each page when `config->rowsPerPage` > 0
+ * @param rows            The array of rows to draw, it is always released by this function
+ * @param config          The configuration used to generate the image
+ */
+static Bool generateImageFromLayoutRows(ByteSink     *sink,
+                                        const utf8   *outputFilePath,
+                                        Rows         rows,
+                                        const Config *config
+                                        ) {
+    assert( sink!=NULL || config->rowsPerPage>0 );
+    assert( outputFilePath!=NULL || config->rowsPerPage<=0 );
+    assert( config!=NULL );
+    
+    if (rows && (config->fitWidth>0 || config->fitHeight>0 || config->aspectRatio>0)) {
+        rows = layoutRowsToFit(rows,config);
+    }
+    if (rows) {
+        if (config->rowsPerPage>0) { generatePagedImagesFromRows(outputFilePath,rows,config); }
+        else                       { generateImageFromRows(sink,rows,config);                 }
+        freeRows(rows);
+    }
+    return success ? TRUE : FALSE;
+}
+
 /**
  * Generates an image displaying the source code contained in the provided buffer
- * @param outputFile       The output file where the image will be stored
+ * @param sink             The output sink where the image will be stored (NULL when generating pages)
+ * @param outputFilePath   The path to the output image, used to name each page when `config->rowsPerPage` > 0
  * @param basicBuffer      A buffer containing the BASIC program
  * @param basicBufferSize  The length of `basicBuffer` in number of bytes
  * @param config           The configuration used to generate the image
  */
-static Bool generateImageFromBasicBuffer(FILE         *outputFile,
+static Bool generateImageFromBasicBuffer(ByteSink     *sink,
+                                         const utf8   *outputFilePath,
                                          const Byte   *basicBuffer,
                                          long         basicBufferSize,
                                          const Config *config
                                          ) {
     
-    Rows rows; int wrapLength;
+    Rows rows; int wrapLength; Bool autoLayout;
     const Computer* computer;
-    assert( outputFile!=NULL );
+    assert( sink!=NULL || config->rowsPerPage>0 );
+    assert( outputFilePath!=NULL || config->rowsPerPage<=0 );
     assert( basicBuffer!=NULL && basicBufferSize>0 );
     assert( config!=NULL && config->computer!=NULL );
     
     computer   = config->computer;
-    wrapLength = config->lineWrapping ? config->lineWidth : 0;
+    autoLayout = (config->fitWidth>0 || config->fitHeight>0 || config->aspectRatio>0);
+    wrapLength = (config->lineWrapping && !autoLayout) ? config->lineWidth : 0;
     assert( computer->decoder && computer->decoder->decode );
     rows = allocRowsFromBasicBuffer( basicBuffer, basicBufferSize, wrapLength, computer->decoder->decode );
-    if (rows) {
-        generateImageFromRows(outputFile,rows,config);
+    return generateImageFromLayoutRows(sink, outputFilePath, rows, config);
+}
+
+/**
+ * Generates an image displaying the differences between two versions of the source code
+ * @param sink            The output sink where the image will be stored (NULL when generating pages)
+ * @param outputFilePath  The path to the output image, used to name each page when `config->rowsPerPage` > 0
+ * @param oldBuffer       A buffer containing the old version of the BASIC program
+ * @param oldBufferSize   The length of `oldBuffer` in number of bytes
+ * @param newBuffer       A buffer containing the new version of the BASIC program
+ * @param newBufferSize   The length of `newBuffer` in number of bytes
+ * @param config          The configuration used to generate the image
+ */
+static Bool generateDiffImageFromBasicBuffers(ByteSink     *sink,
+                                              const utf8   *outputFilePath,
+                                              const Byte   *oldBuffer,
+                                              long         oldBufferSize,
+                                              const Byte   *newBuffer,
+                                              long         newBufferSize,
+                                              const Config *config
+                                              ) {
+    Rows oldRows, newRows, rows=NULL, wrappedRows; Bool autoLayout;
+    DecodeFunc decodeFunc;
+    assert( oldBuffer!=NULL && oldBufferSize>0 );
+    assert( newBuffer!=NULL && newBufferSize>0 );
+    assert( config!=NULL && config->computer!=NULL );
+    assert( config->computer->decoder && config->computer->decoder->decode );
+    
+    /* the lines are compared unwrapped, wrapping is applied to the merged listing */
+    decodeFunc = config->computer->decoder->decode;
+    oldRows    = allocRowsFromBasicBuffer(oldBuffer, oldBufferSize, 0, decodeFunc);
+    newRows    = allocRowsFromBasicBuffer(newBuffer, newBufferSize, 0, decodeFunc);
+    if (oldRows && newRows) { rows = allocDiffRows(oldRows, newRows); }
+    freeRows(oldRows);
+    freeRows(newRows);
+    
+    autoLayout = (config->fitWidth>0 || config->fitHeight>0 || config->aspectRatio>0);
+    if (rows && config->lineWrapping && !autoLayout && config->lineWidth>0) {
+        wrappedRows = allocWrappedRows(rows, config->lineWidth);
         freeRows(rows);
+        rows = wrappedRows;
     }
-    return success ? TRUE : FALSE;
+    return generateImageFromLayoutRows(sink, outputFilePath, rows, config);
+}
+
+/**
+ * Loads the complete content of a BASIC file into a new allocated buffer
+ * @param basicFilePath    The path to the BASIC file
+ * @param out_bufferSize   Pointer to the variable where the length of the buffer will be stored
+ * @returns
+ *      The buffer containing the file, it must be deallocated with 'free()' (NULL on error)
+ */
+static Byte * allocBufferFromBasicFile(const utf8 *basicFilePath, long *out_bufferSize) {
+    FILE *basicFile=NULL; Byte *basicBuffer=NULL; long basicBufferSize=0;
+    assert( basicFilePath!=NULL && out_bufferSize!=NULL );
+    
+    if (success) { /* 1) open BASIC file for reading */
+        basicFile = fopen(basicFilePath,"rb");
+        if (!basicFile) { error(ERR_FILE_NOT_FOUND,basicFilePath); }
+    }
+    if (success) { /* 2) get size of the BASIC file and verify it is valid */
+        basicBufferSize = getFileSize(basicFile);
+        if (basicBufferSize<MIN_FILE_SIZE) { error(ERR_FILE_TOO_SMALL,basicFilePath); }
+        if (basicBufferSize>MAX_FILE_SIZE) { error(ERR_FILE_TOO_LARGE,basicFilePath); }
+    }
+    if (success) { /* 3) allocate space to load the complete BASIC file to memory */
+        basicBuffer = malloc(basicBufferSize);
+        if (!basicBuffer) { error(ERR_NOT_ENOUGH_MEMORY,0); }
+    }
+    if (success) { /* 4) load the BASIC file */
+        if ( basicBufferSize!=fread(basicBuffer,1,basicBufferSize,basicFile) ) {
+            error(ERR_CANNOT_READ_FILE,basicFilePath);
+        }
+    }
+    if (basicFile) { fclose(basicFile); }
+    if (!success) { free(basicBuffer); basicBuffer=NULL; basicBufferSize=0; }
+    (*out_bufferSize) = basicBufferSize;
+    return basicBuffer;
 }
 
 /**
@@ -142,10 +1094,12 @@ Bool generateImageFromBASIC(const utf8     *imageFilePath,
                             const Config   *config)
 {
     const utf8  *imageExtension, *basicFileName;
-    FILE *imageFile=NULL, *basicFile=NULL;
+    ByteSink sink; Bool isSinkOpen=FALSE, isStdout;
     Byte *basicBuffer=NULL; long basicBufferSize=0;
     
     assert( basicFilePath!=NULL && config!=NULL );
+    /* sixel images are written to the terminal unless a file is requested */
+    isStdout = config->imageFormat==SIXEL && imageFilePath==NULL && config->rowsPerPage<=0;
     
     /* add extensions (when appropiate) */
     basicFilePath = allocFilePath(basicFilePath, ".bas", OPTIONAL_EXTENSION);
@@ -158,40 +1112,128 @@ Bool generateImageFromBASIC(const utf8     *imageFilePath,
     
     /*-------------------------------------------------------------------*/
 
-    if (success) { /* 1) open BASIC file for reading */
-        basicFile = fopen(basicFilePath,"rb");
-        if (!basicFile) { error(ERR_FILE_NOT_FOUND,basicFilePath); }
-    }
-    if (success) { /* 2) get size of the BASIC file and verify it is valid */
-        basicBufferSize = getFileSize(basicFile);
-        if (basicBufferSize<MIN_FILE_SIZE) { error(ERR_FILE_TOO_SMALL,basicFilePath); }
-        if (basicBufferSize>MAX_FILE_SIZE) { error(ERR_FILE_TOO_LARGE,basicFilePath); }
+    if (success) { /* 1) load the complete BASIC file to memory */
+        basicBuffer = allocBufferFromBasicFile(basicFilePath, &basicBufferSize);
     }
-    if (success) { /* 3) allocate space to load the complete BASIC file to memory */
-        basicBuffer = malloc(basicBufferSize);
-        if (!basicBuffer) { error(ERR_NOT_ENOUGH_MEMORY,0); }
+    if (success && config->rowsPerPage<=0) { /* 2) open image file for writting (pages use their own files) */
+        isSinkOpen = isStdout ? initFileSink(&sink, stdout) : openFileSink(&sink, imageFilePath);
+        if (!isSinkOpen) { error(ERR_CANNOT_CREATE_FILE,imageFilePath); }
     }
-    if (success) { /* 4) load the BASIC file */
-        if ( basicBufferSize!=fread(basicBuffer,1,basicBufferSize,basicFile) ) {
-            error(ERR_CANNOT_READ_FILE,basicFilePath);
+    if (success) { /* 3) proceed! */
+        if (!isStdout && config->rowsPerPage>0) {
+            printf("Generating the pages of '%s' containing the source code of %s\n", imageFilePath, basicFilePath);
+        } else if (!isStdout) {
+            printf("Generating the image '%s' containing the source code of %s\n", imageFilePath, basicFilePath);
         }
-    }
-    if (success) { /* 5) open image file for writting */
-        imageFile = fopen(imageFilePath,"wb");
-        if (!imageFile) { error(ERR_CANNOT_CREATE_FILE,imageFilePath); }
-    }
-    if (success) { /* 6) proceed! */
-        printf("Generating the image '%s' containing the source code of %s\n", imageFilePath, basicFilePath);
-        generateImageFromBasicBuffer(imageFile, basicBuffer, basicBufferSize, config);
+        generateImageFromBasicBuffer(isSinkOpen ? &sink : NULL, imageFilePath, basicBuffer, basicBufferSize, config);
     }
     /*-------------------------------------------------------------------*/
     
     /* clean up and return */
     if (basicBuffer  ) { free((void*)basicBuffer); }
-    if (basicFile    ) { fclose(basicFile); }
-    if (imageFile    ) { fclose(imageFile); }
+    /* the write errors found while encoding are reported again with the path of the file */
+    if (isSinkOpen && !closeSink(&sink) && (success || theError.id==ERR_CANNOT_WRITE_FILE)) {
+        error(ERR_CANNOT_WRITE_FILE,imageFilePath);
+    }
+    /* an image that could not be generated does not leave an empty or truncated file */
+    if (isSinkOpen && !isStdout && !success) { removeSinkFile(imageFilePath); }
     if (basicFileName) { free((void*)basicFileName); }
     if (basicFilePath) { free((void*)basicFilePath); }
     if (imageFilePath) { free((void*)imageFilePath); }
     return success ? TRUE : FALSE;
 }
+
+/**
+ * Generates an image displaying the differences between two versions of a BASIC program
+ *
+ * The image contains the new version of the program with the added, removed and changed lines highlighted.
+ * @param imageFilePath  The path to the output image (NULL = use the name of the new BASIC program)
+ * @param oldFilePath    The path to the old version of the BASIC program
+ * @param newFilePath    The path to the new version of the BASIC program
+ * @param config         The configuration used to generate the image
+ */
+Bool generateDiffImageFromBASIC(const utf8     *imageFilePath,
+                                const utf8     *oldFilePath,
+                                const utf8     *newFilePath,
+                                const Config   *config)
+{
+    const utf8 *imageExtension, *newFileName;
+    ByteSink sink; Bool isSinkOpen=FALSE, isStdout;
+    Byte *oldBuffer=NULL, *newBuffer=NULL; long oldBufferSize=0, newBufferSize=0;
+    
+    assert( oldFilePath!=NULL && newFilePath!=NULL && config!=NULL );
+    /* sixel images are written to the terminal unless a file is requested */
+    isStdout = config->imageFormat==SIXEL && imageFilePath==NULL && config->rowsPerPage<=0;
+    
+    /* add extensions (when appropiate) */
+    oldFilePath = allocFilePath(oldFilePath, ".bas", OPTIONAL_EXTENSION);
+    newFilePath = allocFilePath(newFilePath, ".bas", OPTIONAL_EXTENSION);
+    newFileName = allocFileNameWithExtension(newFilePath);
+    
+    /* make the path to the image file */
+    imageExtension = getImageExtension(config->imageFormat,newFilePath);
+    if (imageFilePath) { imageFilePath = allocFilePath(imageFilePath,imageExtension,OPTIONAL_EXTENSION); }
+    else               { imageFilePath = allocFilePath(newFileName  ,imageExtension,FORCED_EXTENSION  ); }
+    
+    /*-------------------------------------------------------------------*/
+    
+    if (success) { /* 1) load both versions of the BASIC program to memory */
+        oldBuffer = allocBufferFromBasicFile(oldFilePath, &oldBufferSize);
+    }
+    if (success) {
+        newBuffer = allocBufferFromBasicFile(newFilePath, &newBufferSize);
+    }
+    if (success && config->rowsPerPage<=0) { /* 2) open image file for writting (pages use their own files) */
+        isSinkOpen = isStdout ? initFileSink(&sink, stdout) : openFileSink(&sink, imageFilePath);
+        if (!isSinkOpen) { error(ERR_CANNOT_CREATE_FILE,imageFilePath); }
+    }
+    if (success) { /* 3) proceed! */
+        if (!isStdout) {
+            printf("Generating the image '%s' containing the differences between %s and %s\n",
+                   imageFilePath, oldFilePath, newFilePath);
+        }
+        generateDiffImageFromBasicBuffers(isSinkOpen ? &sink : NULL, imageFilePath, oldBuffer, oldBufferSize,
+                                          newBuffer, newBufferSize, config);
+    }
+    /*-------------------------------------------------------------------*/
+    
+    /* clean up and return */
+    if (oldBuffer    ) { free((void*)oldBuffer); }
+    if (newBuffer    ) { free((void*)newBuffer); }
+    /* the write errors found while encoding are reported again with the path of the file */
+    if (isSinkOpen && !closeSink(&sink) && (success || theError.id==ERR_CANNOT_WRITE_FILE)) {
+        error(ERR_CANNOT_WRITE_FILE,imageFilePath);
+    }
+    /* an image that could not be generated does not leave an empty or truncated file */
+    if (isSinkOpen && !isStdout && !success) { removeSinkFile(imageFilePath); }
+    if (newFileName  ) { free((void*)newFileName); }
+    if (oldFilePath  ) { free((void*)oldFilePath); }
+    if (newFilePath  ) { free((void*)newFilePath); }
+    if (imageFilePath) { free((void*)imageFilePath); }
+    return success ? TRUE : FALSE;
+}
+
+/**
+ * Generates an image displaying the source code of a BASIC program that is already in memory
+ *
+ * The image is written to the provided sink, so an application can render into a memory
+ * sink without any file involved. Pagination is not available (`config->rowsPerPage` is ignored).
+ * @param sink             The sink where the image will be written
+ * @param basicBuffer      A buffer containing the BASIC program
+ * @param basicBufferSize  The length of `basicBuffer` in number of bytes
+ * @param config           The configuration used to generate the image
+ */
+Bool generateImageToSink(ByteSink       *sink,
+                         const Byte     *basicBuffer,
+                         long            basicBufferSize,
+                         const Config   *config)
+{
+    Config singleImageConfig;
+    assert( sink!=NULL );
+    assert( basicBuffer!=NULL && basicBufferSize>0 );
+    assert( config!=NULL );
+    
+    singleImageConfig = (*config);
+    singleImageConfig.rowsPerPage = 0;
+    return generateImageFromBasicBuffer(sink, NULL, basicBuffer, basicBufferSize, &singleImageConfig);
+}
@@ -32,6 +32,7 @@
 #ifndef bas2img_generate_h
 #define bas2img_generate_h
 #include "globals.h"
+#include "sink.h"
 
 
 /**
@@ -45,5 +46,34 @@ Bool generateImageFromBASIC(const utf8     *imageFilePath,
                             const utf8     *basicFilePath,
                             const Config   *config);
 
+/**
+ * Generates an image displaying the differences between two versions of a BASIC program
+ *
+ * The image contains the new version of the program with the added, removed and changed lines highlighted.
+ * @param imageFilePath  The path to the output image (NULL = use the name of the new BASIC program)
+ * @param oldFilePath    The path to the old version of the BASIC program
+ * @param newFilePath    The path to the new version of the BASIC program
+ * @param config         The configuration used to generate the image
+ */
+Bool generateDiffImageFromBASIC(const utf8     *imageFilePath,
+                                const utf8     *oldFilePath,
+                                const utf8     *newFilePath,
+                                const Config   *config);
+
+/**
+ * Generates an image displaying the source code of a BASIC program that is already in memory
+ *
+ * The image is written to the provided sink, so an application can render into a memory
+ * sink without any file involved. Pagination is not available (`config->rowsPerPage` is ignored).
+ * @param sink             The sink where the image will be written
+ * @param basicBuffer      A buffer containing the BASIC program
+ * @param basicBufferSize  The length of `basicBuffer` in number of bytes
+ * @param config           The configuration used to generate the image
+ */
+Bool generateImageToSink(ByteSink       *sink,
+                         const Byte     *basicBuffer,
+                         long            basicBufferSize,
+                         const Config   *config);
+
 
 #endif /* bas2img_generate_h */
@@ -34,6 +34,16 @@
 #include <string.h>
 #include "gif.h"
 #define CHUNK_MAX_LENGTH 255 /* < maximum length of each data-chunk contained in the RASTER DATA BLOCK */
+#define DISPOSAL_NONE    1    /* < disposal method: the frame is left in place and the next one is drawn over it */
+#define PAUSE_DELAY      200  /* < hundredths of second that the last frame of each page of an animation is shown */
+#define min(a,b)         ((a)<(b) ? (a) : (b))
+
+typedef struct WindowSource {
+    ScanlineSource *parent;       /* < the source providing the scanlines of the whole image             */
+    int             top;          /* < the scanline of the parent shown in the first scanline of the window */
+    int             height;       /* < the number of scanlines taken from the parent (the rest are blank)  */
+    const Byte     *blankLine;    /* < a scanline where all pixels have the color 0                        */
+} WindowSource;
 
 /*=================================================================================================================*/
 #pragma mark - > BIT BUFFER
@@ -52,12 +62,12 @@ static void initBitBuffer(BitBuffer* buffer) {
 }
 
 
-static Bool fwriteCode(unsigned code, unsigned length, BitBuffer* buffer, FILE* file) {
+static Bool writeCode(unsigned code, unsigned length, BitBuffer* buffer, ByteSink* sink) {
     unsigned i;
     assert( length>0 );
     assert( code < (1<<length) );
     assert( buffer!=NULL );
-    assert( file!=NULL );
+    assert( sink!=NULL );
     
     for (i=0; i<length; ++i) {
         buffer->byte |= (code&0x01) << buffer->shift++;
@@ -65,8 +75,8 @@ static Bool fwriteCode(unsigned code, unsigned length, BitBuffer* buffer, FILE*
             buffer->array[buffer->index++] = buffer->byte;
             buffer->byte = buffer->shift = 0;
             if (buffer->index==CHUNK_MAX_LENGTH) {
-                fputc(CHUNK_MAX_LENGTH,file);
-                fwrite(buffer->array, sizeof(Byte), CHUNK_MAX_LENGTH, file);
+                writeSinkByte(sink, CHUNK_MAX_LENGTH);
+                writeSinkBytes(sink, buffer->array, CHUNK_MAX_LENGTH);
                 buffer->index = 0;
             }
         }
@@ -76,15 +86,15 @@ static Bool fwriteCode(unsigned code, unsigned length, BitBuffer* buffer, FILE*
 }
 
 /**
- * Clears the buffer and causes any buffered data to be written to the file
+ * Clears the buffer and causes any buffered data to be written to the sink
  * @param buffer  The buffer containing the bits to flush
- * @param file    The output file where the image will be written
+ * @param sink    The output sink where the image will be written
  */
-static void flushBitBuffer(BitBuffer* buffer, FILE* file) {
+static void flushBitBuffer(BitBuffer* buffer, ByteSink* sink) {
     if (buffer->shift>0) { buffer->array[buffer->index++] = buffer->byte; }
     if (buffer->index>0) {
-        fputc(buffer->index,file);
-        fwrite(buffer->array, sizeof(Byte), buffer->index, file);
+        writeSinkByte(sink, buffer->index);
+        writeSinkBytes(sink, buffer->array, buffer->index);
     }
 }
 
@@ -92,40 +102,40 @@ static void flushBitBuffer(BitBuffer* buffer, FILE* file) {
 
 
 /*=================================================================================================================*/
-#pragma mark - > WRITTING TO FILE
+#pragma mark - > WRITTING TO SINK
 
-static Bool fwriteInt16(unsigned value, FILE *file) {
+static Bool writeInt16(unsigned value, ByteSink *sink) {
     unsigned char data[2];
     data[0] = (unsigned char)(value   );
     data[1] = (unsigned char)(value>>8);
-    return 2==fwrite(data, 1, 2, file);
+    return writeSinkBytes(sink, data, 2);
 }
 
-static Bool fwriteInt8(unsigned value, FILE *file) {
-    return fputc(value,file)==value;
+static Bool writeInt8(unsigned value, ByteSink *sink) {
+    return writeSinkByte(sink, value);
 }
 
 /**
  * Write a palette of colors into a GIF file
  * @param bgraColors       An array of colors in format BGRA (first byte=Blue, second byte=Green, ..)
  * @param sizeInBytes      The size of `bgraColors` in bytes
- * @param numberOfColors   Number of color of the palette to write
- * @param file             The output file where the palette will be written
+ * @param numberOfColors   Number of color of the palette to write (maximum 256)
+ * @param sink             The output sink where the palette will be written
  */
-static Bool fwritePaletteBGRA(const Byte* bgraColors, int sizeInBytes, int numberOfColors, FILE *file) {
-    int i; const Byte *last, *bgra; Byte rgb[3];
+static Bool writePaletteBGRA(const Byte* bgraColors, int sizeInBytes, int numberOfColors, ByteSink *sink) {
+    int i; const Byte *last, *bgra; Byte rgb[256*3], *ptr;
     assert( bgraColors!=NULL && sizeInBytes>0 );
-    assert( numberOfColors>0 );
-    assert( file!=NULL );
+    assert( 0<numberOfColors && numberOfColors<=256 );
+    assert( sink!=NULL );
     
+    /* the whole palette is converted to RGB and written at once */
     bgra = bgraColors;
     last = &bgra[sizeInBytes-4];
-    for (i=0; i<numberOfColors; ++i) {
-        if (bgra<=last) { rgb[0]=bgra[2]; rgb[1]=bgra[1]; rgb[2]=bgra[0]; bgra+=4; }
-        else            { rgb[0]=rgb[1]=rgb[2]=0; }
-        if ( 3!=fwrite(rgb, 1, 3, file) ) { return FALSE; }
+    for (i=0, ptr=rgb; i<numberOfColors; ++i, ptr+=3) {
+        if (bgra<=last) { ptr[0]=bgra[2]; ptr[1]=bgra[1]; ptr[2]=bgra[0]; bgra+=4; }
+        else            { ptr[0]=ptr[1]=ptr[2]=0; }
     }
-    return TRUE;
+    return writeSinkBytes(sink, rgb, numberOfColors*3);
 }
 
 
@@ -172,7 +182,7 @@ void freeStrTable(StrTable* table) {
 
 
 /*=================================================================================================================*/
-#pragma mark - > WRITTING GIF ELEMENTS TO FILE
+#pragma mark - > WRITTING GIF ELEMENTS TO SINK
 
 /**
  * Writes the GIF header
@@ -181,12 +191,12 @@ void freeStrTable(StrTable* table) {
  * @param bitsPerPixel    The number of bits for each pixel (valid values: 1 or 8)
  * @param colorTable      An array of RGBA elements that maps values in the pixel-data to rgb colors
  */
-static Bool fwriteHeader(int         width,
-                         int         height,
-                         int         bitsPerPixel,
-                         const void* colorTable,
-                         int         colorTableSize,
-                         FILE*       file)
+static Bool writeHeader(int         width,
+                        int         height,
+                        int         bitsPerPixel,
+                        const void* colorTable,
+                        int         colorTableSize,
+                        ByteSink*   sink)
 {
     const int bitsPerComponent    = bitsPerPixel==1 ? 5 : 8;
     const int numberOfColors      = 1<<bitsPerPixel;
@@ -199,29 +209,32 @@ static Bool fwriteHeader(int         width,
     flags = useGlobalColorTable<<7 | (bitsPerComponent-1)<<4 | (bitsPerPixel-1);
     
     /* write signature */
-    fputs("GIF89a",file);
+    writeSinkBytes(sink, "GIF89a", 6);
     /* write screen descriptor */
-    fwriteInt16(width          , file);
-    fwriteInt16(height         , file);
-    fwriteInt8 (flags          , file);
-    fwriteInt8 (backgroundColor, file);
-    fwriteInt8 (aspectRatio    , file);
+    writeInt16(width          , sink);
+    writeInt16(height         , sink);
+    writeInt8 (flags          , sink);
+    writeInt8 (backgroundColor, sink);
+    writeInt8 (aspectRatio    , sink);
     /* write color table */
-    fwritePaletteBGRA(colorTable, colorTableSize, numberOfColors, file);
-    return TRUE;
+    return writePaletteBGRA(colorTable, colorTableSize, numberOfColors, sink);
 }
 
 /**
- * Writes the GIF image descriptor to the specified file
+ * Writes the GIF image descriptor to the specified sink
+ * @param left             The X coordinate of the image within the logical screen
+ * @param top              The Y coordinate of the image within the logical screen
  * @param width            The width of the image in pixels
  * @param height           The height of the image in pixels
  * @param bitsPerPixel     The number of bits for each pixel (valid values: 1 or 8)
- * @param file             The output file where the descriptor will be stored
+ * @param sink             The output sink where the descriptor will be stored
  */
-static Bool fwriteImageDescriptor(int   width,
-                                  int   height,
-                                  int   bitsPerPixel,
-                                  FILE* file)
+static Bool writeImageDescriptor(int       left,
+                                 int       top,
+                                 int       width,
+                                 int       height,
+                                 int       bitsPerPixel,
+                                 ByteSink* sink)
 {
     const int useLocalColorTable = 0; /* not use local color table */
     const int interlace          = 0; /* image is NOT interlaced   */
@@ -232,34 +245,62 @@ static Bool fwriteImageDescriptor(int   width,
     fields = useLocalColorTable<<7 | interlace<<6 | sorted<<5 | (bitsPerPixel-1);
 
     /* write image descriptor */
-    fwriteInt8 ( 0x2C , file); /* image separator */
-    fwriteInt16(  0   , file); /* image left position */
-    fwriteInt16(  0   , file); /* image top position */
-    fwriteInt16(width , file); /* image width */
-    fwriteInt16(height, file); /* image height */
-    fwriteInt8 (fields, file); /* packed fields */
-    return TRUE;
+    writeInt8 ( 0x2C , sink); /* image separator */
+    writeInt16( left , sink); /* image left position */
+    writeInt16( top  , sink); /* image top position */
+    writeInt16(width , sink); /* image width */
+    writeInt16(height, sink); /* image height */
+    return writeInt8(fields, sink); /* packed fields */
+}
+
+/**
+ * Writes the application extension that makes an animation loop forever (NETSCAPE2.0)
+ * @param sink             The output sink where the extension will be stored
+ */
+static Bool writeLoopExtension(ByteSink* sink) {
+    writeInt8 ( 0x21 , sink); /* extension introducer */
+    writeInt8 ( 0xFF , sink); /* application extension label */
+    writeInt8 (  11  , sink); /* size of the application identifier and authentication code */
+    writeSinkBytes(sink, "NETSCAPE2.0", 11);
+    writeInt8 (   3  , sink); /* size of the sub-block */
+    writeInt8 (   1  , sink); /* sub-block id */
+    writeInt16(   0  , sink); /* number of loops (0 = forever) */
+    return writeInt8(0, sink); /* block terminator */
+}
+
+/**
+ * Writes the graphic control extension that precedes each frame of an animation
+ * @param delay             The time the frame is shown in hundredths of second
+ * @param disposal          What is done with the frame before drawing the next one, ex: DISPOSAL_NONE
+ * @param transparentColor  The palette index of the pixels that are not drawn (-1 = no transparent pixels)
+ * @param sink              The output sink where the extension will be stored
+ */
+static Bool writeGraphicControl(int       delay,
+                                int       disposal,
+                                int       transparentColor,
+                                ByteSink* sink)
+{
+    const int hasTransparency = transparentColor>=0 ? 1 : 0;
+    writeInt8 ( 0x21 , sink); /* extension introducer */
+    writeInt8 ( 0xF9 , sink); /* graphic control label */
+    writeInt8 (   4  , sink); /* block size */
+    writeInt8 ( disposal<<2 | hasTransparency, sink);
+    writeInt16( delay, sink);
+    writeInt8 ( hasTransparency ? transparentColor : 0, sink);
+    return writeInt8(0, sink); /* block terminator */
 }
 
 /**
  * Writes the pixel data of a GIF image using LZW compression
- * @param width           The width of the image in pixels
- * @param height          The height of the image in pixels
- * @param scanlineSize    The number of bytes from one line of pixels to the next (negative = upside-down image)
- * @param bitsPerPixel    The number of bits for each pixel (valid values: 1 or 8)
- * @param pixelData       An array of values describing each pixel of the image
- * @param pixelDataSize   The size of `pixelData` in number of BYTES
- * @param file            The output file where the image will be written
+ * @param source          The source providing the scanlines of the image (from top to bottom)
+ * @param sink            The output sink where the image will be written
  */
-static Bool fwriteLzwImage(int         width,
-                           int         height,
-                           int         scanlineSize,
-                           int         bitsPerPixel,
-                           const void* pixelData,
-                           int         pixelDataSize,
-                           FILE*       file)
+static Bool writeLzwImage(ScanlineSource *source, ByteSink *sink)
 {
-    int x,y; Bool upsideDown=FALSE;
+    int x,y, scanlineY=0, numberOfScanlines=0;
+    const int width            = source->width;
+    const int height           = source->height;
+    const int bitsPerPixel     = source->bitsPerPixel;
     const int initialCodeSize  = (bitsPerPixel>2) ? bitsPerPixel : 2;
     const int clearCode        = 1 << initialCodeSize;
     const int endOfInformation = clearCode+1;
@@ -271,24 +312,26 @@ static Bool fwriteLzwImage(int         width,
 
     StrTable* strTable;
     BitBuffer buffer;
-    const Byte *pixels, *scanline;
+    const Byte *scanlines=NULL, *scanline;
     
     assert( width>0 && height>0 );
     assert( bitsPerPixel==1 || /* bitsPerPixel==4 ||*/ bitsPerPixel==8 );
     
-    /* handle "upside-down" images */
-    if ( scanlineSize<0 ) { scanlineSize=-scanlineSize; upsideDown=TRUE; }
-    assert( scanlineSize>=(width*bitsPerPixel/8) );
-    
     strTable = allocStrTable();
+    if (!strTable) { return FALSE; }
     initStrTable(strTable, initialTableSize);
     initBitBuffer(&buffer);
-    fputc(initialCodeSize,file);
+    writeSinkByte(sink, initialCodeSize);
     
-    fwriteCode(clearCode, codeSize, &buffer,file);
-    pixels = (const Byte*)pixelData;
+    writeCode(clearCode, codeSize, &buffer,sink);
     for (y=0; y<height; ++y) {
-        scanline = &pixels[ scanlineSize * (upsideDown ? (height-y-1) : y) ];
+        /* pull the next group of scanlines from the source when the current one is exhausted */
+        if (y>=scanlineY+numberOfScanlines) {
+            scanlines = readScanlines(source, y, &numberOfScanlines);
+            if (!scanlines) { freeStrTable(strTable); return FALSE; }
+            scanlineY = y;
+        }
+        scanline = &scanlines[ (long)source->scanlineSize * (y-scanlineY) ];
         for (x=0; x<width; ++x) {
             
             /* get pixel color at position x,y */
@@ -302,8 +345,8 @@ static Bool fwriteLzwImage(int         width,
 #       if defined(DISABLE_GIF_COMPRESSION)
             
             /* write with no compression */
-            fwriteCode(    pixel, codeSize,  &buffer,file);
-            fwriteCode(clearCode, codeSize,  &buffer,file);
+            writeCode(    pixel, codeSize, &buffer,sink);
+            writeCode(clearCode, codeSize, &buffer,sink);
             
 #       else
             
@@ -311,12 +354,12 @@ static Bool fwriteLzwImage(int         width,
             strCode = findConcatenation(strTable, prevStrCode, pixel);
             if (strCode<0) {
                 strCode = pixel;
-                fwriteCode(prevStrCode,codeSize, &buffer,file);
+                writeCode(prevStrCode,codeSize, &buffer,sink);
                 if ( strTable->size > (1<<codeSize) ) {
                     if ( ++codeSize==13 ) {
                         codeSize = initialCodeSize+1;
                         initStrTable(strTable,initialTableSize);
-                        fwriteCode(clearCode, 12, &buffer,file);
+                        writeCode(clearCode, 12, &buffer,sink);
                     }
                 }
             }
@@ -328,18 +371,79 @@ static Bool fwriteLzwImage(int         width,
     }
     
     /* write the last pending sequence and the "end-of-info" delimiter */
-    fwriteCode( prevStrCode,      codeSize,  &buffer,file);
-    fwriteCode( endOfInformation, codeSize,  &buffer,file);
+    writeCode( prevStrCode,      codeSize, &buffer,sink);
+    writeCode( endOfInformation, codeSize, &buffer,sink);
     
     /* flush any remaining data contained in the bit-buffer */
-    flushBitBuffer(&buffer, file);
+    flushBitBuffer(&buffer, sink);
     
     /* write image block terminator */
-    fputc(0, file);
+    writeSinkByte(sink, 0);
     
     /* release resources and return*/
     freeStrTable(strTable);
-    return TRUE;
+    return !sink->hasFailed;
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > ANIMATION
+
+/**
+ * Provides the scanlines of a frame reading them from a window of the whole image
+ * (this function is used as the `readScanlines` method of a ScanlineSource)
+ * @param source                 The source whose context is a `WindowSource`
+ * @param y                      The index of the first scanline requested
+ * @param out_numberOfScanlines  Pointer to the variable where the number of available scanlines will be stored
+ */
+static const Byte * readWindowScanlines(ScanlineSource *source, int y, int *out_numberOfScanlines) {
+    WindowSource *window = (WindowSource*)source->context; const Byte *scanlines;
+    assert( window!=NULL && out_numberOfScanlines!=NULL );
+    
+    if (y>=window->height) { (*out_numberOfScanlines)=1; return window->blankLine; }
+    scanlines = readScanlines(window->parent, window->top+y, out_numberOfScanlines);
+    if (scanlines) { (*out_numberOfScanlines) = min(*out_numberOfScanlines, window->height-y); }
+    return scanlines;
+}
+
+/**
+ * Writes a frame of an animation that draws a band of scanlines of the image over the screen
+ *
+ * The frame is left in place when the next one is drawn, so the rest of the screen
+ * keeps the content of the previous frames.
+ * @param source         The source providing the scanlines of the whole image
+ * @param y              The first scanline of the image drawn by the frame
+ * @param numberOfLines  The number of scanlines of the image drawn by the frame
+ * @param screenTop      The position in the screen where the frame is drawn
+ * @param frameHeight    The height of the frame, the scanlines after `numberOfLines` are blank
+ * @param delay          The time the frame is shown in hundredths of second
+ * @param blankLine      A scanline where all pixels have the color 0
+ * @param sink           The output sink where the frame will be written
+ */
+static Bool writeFrame(ScanlineSource *source,
+                       int             y,
+                       int             numberOfLines,
+                       int             screenTop,
+                       int             frameHeight,
+                       int             delay,
+                       const Byte     *blankLine,
+                       ByteSink       *sink)
+{
+    ScanlineSource frame; WindowSource window;
+    assert( source!=NULL && blankLine!=NULL );
+    assert( numberOfLines>0 && numberOfLines<=frameHeight );
+    
+    window.parent       = source;
+    window.top          = y;
+    window.height       = numberOfLines;
+    window.blankLine    = blankLine;
+    frame               = (*source);
+    frame.height        = frameHeight;
+    frame.readScanlines = readWindowScanlines;
+    frame.context       = &window;
+    writeGraphicControl(delay, DISPOSAL_NONE, -1, sink);
+    writeImageDescriptor(0, screenTop, frame.width, frame.height, frame.bitsPerPixel, sink);
+    return writeLzwImage(&frame, sink);
 }
 
 
@@ -347,7 +451,67 @@ static Bool fwriteLzwImage(int         width,
 #pragma mark - > PUBLIC FUNCTIONS
 
 /**
- * Writes an image to file using the GIF format
+ * Writes an image to a sink using the GIF format reading its pixels from a scanline source
+ * @param source          The source providing the size, the palette and the scanlines of the image
+ * @param sink            The output sink where the image will be written
+ */
+Bool writeGifFromSource(ScanlineSource *source, ByteSink *sink) {
+    assert( source!=NULL );
+    assert( source->width>0 && source->height>0 );
+    assert( source->bitsPerPixel==1 || source->bitsPerPixel==8 );
+    assert( source->colorTable!=NULL && source->colorTableSize>0 );
+    assert( sink!=NULL );
+    
+    writeHeader(source->width, source->height, source->bitsPerPixel, source->colorTable, source->colorTableSize, sink);
+    writeImageDescriptor(0, 0, source->width, source->height, source->bitsPerPixel, sink);
+    return writeLzwImage(source, sink);
+}
+
+/**
+ * Writes an animated GIF that shows the image provided by a scanline source page by page
+ * @param source           The source providing the size, the palette and the scanlines of the whole image
+ * @param screenHeight     The height of the screen in pixels
+ * @param stepHeight       The number of scanlines added to the screen by each frame
+ * @param delay            The time each frame is shown in hundredths of second
+ * @param sink             The output sink where the animation will be written
+ */
+Bool writePagedGifFromSource(ScanlineSource *source,
+                             int            screenHeight,
+                             int            stepHeight,
+                             int            delay,
+                             ByteSink       *sink)
+{
+    int pageTop, pageEnd, y, numberOfLines; Byte *blankLine; Bool ok=TRUE;
+    assert( source!=NULL );
+    assert( source->width>0 && source->height>0 );
+    assert( source->bitsPerPixel==1 || source->bitsPerPixel==8 );
+    assert( source->colorTable!=NULL && source->colorTableSize>0 );
+    assert( screenHeight>0 && stepHeight>0 );
+    assert( sink!=NULL );
+    
+    screenHeight = min(screenHeight, source->height);
+    blankLine    = calloc(source->scanlineSize>0 ? source->scanlineSize : -source->scanlineSize, 1);
+    if (!blankLine) { return FALSE; }
+    
+    writeHeader(source->width, screenHeight, source->bitsPerPixel, source->colorTable, source->colorTableSize, sink);
+    writeLoopExtension(sink);
+    for (pageTop=0; pageTop<source->height && ok; pageTop=pageEnd) {
+        pageEnd = min(pageTop+screenHeight, source->height);
+        for (y=pageTop; y<pageEnd && ok; y+=numberOfLines) {
+            numberOfLines = min(stepHeight, pageEnd-y);
+            /* the first frame of a page clears the screen, the last one pauses so the page can be read */
+            ok = writeFrame(source, y, numberOfLines,
+                            y-pageTop, y==pageTop ? screenHeight : numberOfLines,
+                            y+numberOfLines==pageEnd ? PAUSE_DELAY : delay, blankLine, sink);
+        }
+    }
+    writeInt8(0x3B, sink); /* trailer */
+    free(blankLine);
+    return ok && !sink->hasFailed;
+}
+
+/**
+ * Writes an image to a sink using the GIF format
  * @param width           The width of the image in pixels
  * @param height          The height of the image in pixels
  * @param scanlineSize    The number of bytes from one line of pixels to the next (negative = upside-down image)
@@ -356,29 +520,28 @@ static Bool fwriteLzwImage(int         width,
  * @param colorTableSize  The size of `colorTable` in number of BYTES
  * @param pixelData       An array of values describing each pixel of the image
  * @param pixelDataSize   The size of `pixelData` in number of BYTES
- * @param file            The output file where the image will be written
+ * @param sink            The output sink where the image will be written
  */
-Bool fwriteGif(int         width,
-               int         height,
-               int         scanlineSize,
-               int         bitsPerPixel,
-               const void* colorTable,
-               int         colorTableSize,
-               const void* pixelData,
-               int         pixelDataSize,
-               FILE*       file)
+Bool writeGif(int         width,
+              int         height,
+              int         scanlineSize,
+              int         bitsPerPixel,
+              const void* colorTable,
+              int         colorTableSize,
+              const void* pixelData,
+              long        pixelDataSize,
+              ByteSink*   sink)
 {
+    ScanlineSource source;
     assert( width>0 && height>0 );
     assert( scanlineSize!=0 );
     assert( bitsPerPixel==1 || bitsPerPixel==8 );
     assert( colorTable!=NULL && colorTableSize>0 );
     assert( pixelData!=NULL && pixelDataSize>0 );
-    assert( file!=NULL );
+    assert( sink!=NULL );
+    assert( (long)(scanlineSize<0 ? -scanlineSize : scanlineSize) * height <= pixelDataSize );
     
-    fwriteHeader(width, height, bitsPerPixel, colorTable, colorTableSize, file);
-    fwriteImageDescriptor(width, height, bitsPerPixel, file);
-    fwriteLzwImage(width, height, scanlineSize, bitsPerPixel, pixelData, pixelDataSize, file);
-    return TRUE;
+    initMemoryScanlineSource(&source, width, height, scanlineSize, bitsPerPixel, colorTable, colorTableSize, pixelData);
+    return writeGifFromSource(&source, sink);
 }
 
-
@@ -31,12 +31,13 @@
  */
 #ifndef bas2img_gif_h
 #define bas2img_gif_h
-#include <stdio.h>
 #include "globals.h"
+#include "scanline.h"
+#include "sink.h"
 
 
 /**
- * Writes an image to file using the GIF format
+ * Writes an image to a sink using the GIF format
  * @param width           The width of the image in pixels
  * @param height          The height of the image in pixels
  * @param scanlineSize    The number of bytes from one line of pixels to the next (negative = upside-down image)
@@ -45,17 +46,46 @@
  * @param colorTableSize  The size of `colorTable` in number of BYTES
  * @param pixelData       An array of values describing each pixel of the image
  * @param pixelDataSize   The size of `pixelData` in number of BYTES
- * @param file            The output file where the image will be stored
+ * @param sink            The output sink where the image will be stored
  */
-Bool fwriteGif(int         width,
-               int         height,
-               int         scanlineSize,
-               int         bitsPerPixel,
-               const void* colorTable,
-               int         colorTableSize,
-               const void* pixelData,
-               int         pixelDataSize,
-               FILE*       file);
+Bool writeGif(int         width,
+              int         height,
+              int         scanlineSize,
+              int         bitsPerPixel,
+              const void* colorTable,
+              int         colorTableSize,
+              const void* pixelData,
+              long        pixelDataSize,
+              ByteSink*   sink);
+
+/**
+ * Writes an image to a sink using the GIF format reading its pixels from a scanline source
+ *
+ * The scanlines are requested from top to bottom, so the source can produce the image
+ * in bands without keeping it entirely in memory.
+ * @param source          The source providing the size, the palette and the scanlines of the image
+ * @param sink            The output sink where the image will be stored
+ */
+Bool writeGifFromSource(ScanlineSource *source, ByteSink *sink);
+
+/**
+ * Writes an animated GIF that shows the image provided by a scanline source page by page
+ *
+ * The image is split in pages of the height of the screen and each frame draws the next `stepHeight`
+ * scanlines below the previous ones, the way a listing is printed on a screen that is cleared when
+ * it is full. The frames only contain the new scanlines and are left in place, so the size of the file
+ * and the encoding time grow with the size of the image and not with the number of frames.
+ * @param source           The source providing the size, the palette and the scanlines of the whole image
+ * @param screenHeight     The height of the screen in pixels (the width is the width of the image)
+ * @param stepHeight       The number of scanlines added to the screen by each frame
+ * @param delay            The time each frame is shown in hundredths of second
+ * @param sink             The output sink where the animation will be written
+ */
+Bool writePagedGifFromSource(ScanlineSource *source,
+                             int            screenHeight,
+                             int            stepHeight,
+                             int            delay,
+                             ByteSink       *sink);
 
 
 #endif /* bas2img_gif_h */
@@ -59,7 +59,9 @@ typedef int Bool; enum { FALSE=0, TRUE }; /* < a boolean value (TRUE/FALSE)
 #pragma mark - > BAS2IMG TYPES
 
 typedef unsigned char Char256;            /* < one of 256 characters defined in the home computer character-set */
-typedef enum ImageFormat { BMP, GIF             } ImageFormat;
+typedef unsigned char Attr;               /* < the syntax category of a character, used to highlight the code   */
+enum { ATTR_PLAIN=0, ATTR_KEYWORD, ATTR_STRING, ATTR_NUMBER, ATTR_COMMENT, NUMBER_OF_ATTRS };
+typedef enum ImageFormat { BMP, GIF, PNG, TIFF, SVG, SIXEL } ImageFormat;
 typedef enum Orientation { HORIZONTAL, VERTICAL } Orientation;
 
 /**
@@ -73,12 +75,16 @@ typedef Bool (*IsDecodableFunc)(const Byte *sour, int sourLen);
  * Prototype of function used to decode basic lines
  *
  * The destination buffer is guaranteed to have space for at least 32 bytes (MIN_DECODE_BUF_SIZE)
+ * and the attribute buffer always has the same capacity. The attributes are classified in the
+ * same pass that decodes the characters, using `inout_state` to keep track of strings, comments, etc.
  *
  * @param inout_dest   The destination buffer where to store the decoded data.
+ * @param inout_attr   The destination buffer where to store the attribute of each decoded character
+ * @param inout_state  The lexical state preserved between calls (it is zero at the beginning of each line)
  * @param inout_sour   The source buffer with the content to decode
  * @param sourLen      The source buffer length in number of bytes (always greater than zero)
  */
-typedef Bool (*DecodeFunc)(Byte **inout_dest, const Byte **inout_sour, int sourLen);
+typedef Bool (*DecodeFunc)(Byte **inout_dest, Attr **inout_attr, int *inout_state, const Byte **inout_sour, int sourLen);
 
 
 
@@ -113,10 +119,22 @@ typedef struct Config {
     int  charWidth;     /* < character width in pixels  (default 0) */
     int  charHeight;    /* < character height in pixels (default 0) */
     int  charScale;     /* < the magnification scale (default 0)    */
+    double fractionalScale; /* < non-integer magnification scale, drawn with filtering (0 = use charScale) */
+    double pixelAspect;     /* < width/height ratio of each pixel of the font (0 = square pixels)       */
     int  margin;        /* < margin around the box  */
     int  padding;       /* < padding within the box */
     int  lineWidth;     /* < maximum number of characters per line (0 = use the longest line length) */
     Bool lineWrapping;  /* < TRUE = wraps lines that exceed the line width */
+    int  rowsPerPage;   /* < maximum number of rows per image (0 = generate a single image) */
+    int  animationRows; /* < number of rows of the screen of a scrolling GIF animation (0 = still image) */
+    int  fitWidth;      /* < maximum image width in pixels used to choose the wrap length (0 = no limit)   */
+    int  fitHeight;     /* < maximum image height in pixels used to choose the wrap length (0 = no limit)  */
+    double aspectRatio; /* < desired image width/height ratio used to choose the wrap length (0 = ignore) */
+    Bool highlighting;  /* < TRUE = draw keywords, strings, numbers and comments with different colors */
+    Bool monochrome;    /* < TRUE = render a two colors image with 1 bit per pixel (no syntax or diff colors) */
+    int  numberOfThreads; /* < number of threads used to render the image (0 = one per processor) */
+    Bool thumbnail;     /* < TRUE = generate a small overview image with one pixel per character */
+    Bool rleCompression;  /* < TRUE = compress BMP images with RLE4 or RLE8 (depending on the number of colors) */
     ImageFormat    imageFormat;  /* < image file format (BMP, GIF, ...) */
     Orientation    orientation;  /* < image orientation (vertical or horizontal) */
     const Computer *computer;    /* < computer description */
@@ -0,0 +1,321 @@
+/**
+ * @file       glyphs.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "glyphs.h"
+#include "cpu.h"
+#define min(a,b)  ((a)<(b) ? (a) : (b))
+#define CHARWIDTH  8
+#define CHARHEIGHT 8
+
+/*
+ * The SIMD kernels are compiled for each instruction set using function attributes, so the same
+ * binary includes every tier and the one used is selected at runtime (see cpu.h).
+ * Define DISABLE_SIMD to build only the scalar code.
+ */
+#if !defined(DISABLE_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define USE_X86_SIMD
+#   include <immintrin.h>
+#   define TARGET_generic
+#   define TARGET_sse2 __attribute__((target("sse2")))
+#   define TARGET_avx2 __attribute__((target("avx2")))
+#endif
+
+
+/*=================================================================================================================*/
+#pragma mark - > ROW BLENDING
+
+/* The blend of each chunk of pixels: dest = (dest & ~mask) | (color & mask) */
+#define BLEND_1_generic(d,m,i) (d)[i] = (Byte)(((d)[i] & ~(m)[i]) | (color & (m)[i]))
+#define BLEND_8_generic(d,m)  BLEND_1_generic(d,m,0); BLEND_1_generic(d,m,1); BLEND_1_generic(d,m,2); \
+                              BLEND_1_generic(d,m,3); BLEND_1_generic(d,m,4); BLEND_1_generic(d,m,5); \
+                              BLEND_1_generic(d,m,6); BLEND_1_generic(d,m,7)
+#define BLEND_16_generic(d,m) BLEND_8_generic(d,m); BLEND_8_generic((d)+8,(m)+8)
+#define BLEND_32_generic(d,m) BLEND_16_generic(d,m); BLEND_16_generic((d)+16,(m)+16)
+#define BLEND_8_sse2(d,m)  _mm_storel_epi64((__m128i*)(d), _mm_or_si128(                                \
+        _mm_andnot_si128(_mm_loadl_epi64((const __m128i*)(m)), _mm_loadl_epi64((const __m128i*)(d))), \
+        _mm_and_si128   (_mm_loadl_epi64((const __m128i*)(m)), _mm_set1_epi8((char)color))))
+#define BLEND_16_sse2(d,m) _mm_storeu_si128((__m128i*)(d), _mm_or_si128(                                \
+        _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(m)), _mm_loadu_si128((const __m128i*)(d))), \
+        _mm_and_si128   (_mm_loadu_si128((const __m128i*)(m)), _mm_set1_epi8((char)color))))
+#define BLEND_32_sse2(d,m) BLEND_16_sse2(d,m); BLEND_16_sse2((d)+16,(m)+16)
+#define BLEND_8_avx2(d,m)  BLEND_8_sse2(d,m)
+#define BLEND_16_avx2(d,m) BLEND_16_sse2(d,m)
+#define BLEND_32_avx2(d,m) _mm256_storeu_si256((__m256i*)(d), _mm256_blendv_epi8(                      \
+        _mm256_loadu_si256((const __m256i*)(d)), _mm256_set1_epi8((char)color),                        \
+        _mm256_loadu_si256((const __m256i*)(m))))
+
+/**
+ * Defines the function that blends a row of a glyph mask of any width over a row of pixels
+ *
+ * The whole row is processed in wide chunks; the bytes of the mask beyond the width of the
+ * glyph are zero, so the padding leaves the pixels untouched (ex: the 6 pixels MSX characters).
+ */
+#define DEFINE_BLEND_ROW(tier)                                                                  \
+static TARGET_##tier void blendRow_##tier(Byte *dest, const Byte *mask, int width, Byte color) { \
+    int i=0;                                                                                    \
+    for ( ; i+32<=width; i+=32) { BLEND_32_##tier(&dest[i],&mask[i]); }                          \
+    for ( ; i+8 <=width; i+=8 ) { BLEND_8_##tier (&dest[i],&mask[i]); }                          \
+    for ( ; i<width; ++i) { BLEND_1_generic(dest,mask,i); }                                     \
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > RASTER KERNELS
+
+/*
+ * Each kernel blits a glyph of a fixed geometry with the inner loop fully unrolled.
+ * All the (charWidth, scale) combinations that pad to the same mask stride share the kernel
+ * (the padding bytes of the mask are zero), and the height is the number of rows left after
+ * trimming the blank rows of each glyph, so it is the only loop bound known at runtime.
+ */
+
+#define BLEND_ROW_8(tier,d,m)  BLEND_8_##tier(d,m)
+#define BLEND_ROW_16(tier,d,m) BLEND_16_##tier(d,m)
+#define BLEND_ROW_24(tier,d,m) BLEND_16_##tier(d,m); BLEND_8_##tier((d)+16,(m)+16)
+#define BLEND_ROW_32(tier,d,m) BLEND_32_##tier(d,m)
+
+/** Copies one byte of a packed 1-bpp row that starts at a byte boundary */
+#define COPY_BITS(d,b,i) (d)[i] |= (b)[i]
+/** Merges one byte of a packed 1-bpp row at the bit position `shift` (the second byte only when needed) */
+#define MERGE_BITS(d,b,i) \
+    (d)[i] |= (Byte)((b)[i]>>shift); if ((Byte)((b)[i]<<(8-shift))) { (d)[i+1] |= (Byte)((b)[i]<<(8-shift)); }
+#define BITS_ROW_1(OP,d,b) OP(d,b,0)
+#define BITS_ROW_2(OP,d,b) OP(d,b,0); OP(d,b,1)
+#define BITS_ROW_3(OP,d,b) OP(d,b,0); OP(d,b,1); OP(d,b,2)
+#define BITS_ROW_4(OP,d,b) OP(d,b,0); OP(d,b,1); OP(d,b,2); OP(d,b,3)
+
+/** Defines the kernel that blits 8-bpp glyphs with masks of `stride` bytes per row */
+#define DEFINE_KERNEL_8BPP(tier,stride)                                                           \
+static TARGET_##tier void blit8bpp_##stride##_##tier(Byte *dest, const Byte *mask, int numberOfRows, \
+                                     int width, int scanlineSize, int maskStride, int shift, Byte color) { \
+    while (numberOfRows-->0) { BLEND_ROW_##stride(tier,dest,mask); dest+=scanlineSize; mask+=stride; } \
+}
+
+/** Defines the kernel that blits 8-bpp glyphs of any geometry */
+#define DEFINE_GENERIC_KERNEL_8BPP(tier)                                                          \
+static TARGET_##tier void blit8bppAny_##tier(Byte *dest, const Byte *mask, int numberOfRows,      \
+                                     int width, int scanlineSize, int maskStride, int shift, Byte color) { \
+    while (numberOfRows-->0) { blendRow_##tier(dest,mask,width,color); dest+=scanlineSize; mask+=maskStride; } \
+}
+
+/** Defines the kernel that merges 1-bpp glyphs with rows of `stride` bytes (it only sets pixels) */
+#define DEFINE_KERNEL_1BPP(stride)                                                              \
+static void blit1bpp_##stride(Byte *dest, const Byte *bits, int numberOfRows, int width,     \
+                               int scanlineSize, int maskStride, int shift, Byte color) {     \
+    if (shift==0) {                                                                           \
+        while (numberOfRows-->0) { BITS_ROW_##stride(COPY_BITS ,dest,bits); dest+=scanlineSize; bits+=stride; } \
+    } else {                                                                                  \
+        while (numberOfRows-->0) { BITS_ROW_##stride(MERGE_BITS,dest,bits); dest+=scanlineSize; bits+=stride; } \
+    }                                                                                         \
+}
+
+/** Defines all the 8-bpp kernels of an instruction set */
+#define DEFINE_KERNELS_8BPP(tier) \
+    DEFINE_BLEND_ROW(tier)        \
+    DEFINE_KERNEL_8BPP(tier,8)    \
+    DEFINE_KERNEL_8BPP(tier,16)   \
+    DEFINE_KERNEL_8BPP(tier,24)   \
+    DEFINE_KERNEL_8BPP(tier,32)   \
+    DEFINE_GENERIC_KERNEL_8BPP(tier)
+
+DEFINE_KERNELS_8BPP(generic)
+#ifdef USE_X86_SIMD
+DEFINE_KERNELS_8BPP(sse2)
+DEFINE_KERNELS_8BPP(avx2)
+#endif
+DEFINE_KERNEL_1BPP(1)
+DEFINE_KERNEL_1BPP(2)
+DEFINE_KERNEL_1BPP(3)
+DEFINE_KERNEL_1BPP(4)
+
+/**
+ * Merges 1-bpp glyphs of any geometry at any bit position (color zero clears the pixels)
+ */
+static void blit1bppAny(Byte *dest, const Byte *bits, int numberOfRows, int width,
+                        int scanlineSize, int maskStride, int shift, Byte color) {
+    int k; Byte high, low;
+    while (numberOfRows-->0) {
+        for (k=0; k<width; ++k) {
+            high = (Byte)(bits[k] >> shift);
+            low  = (Byte)(bits[k] << (8-shift));
+            if (color) { dest[k] |= high; if (low) { dest[k+1] |= low;  } }
+            else       { dest[k] &=~high; if (low) { dest[k+1] &= ~low; } }
+        }
+        dest += scanlineSize;
+        bits += maskStride;
+    }
+}
+
+/** The row of the kernel table with the 8-bpp kernels of an instruction set */
+#define KERNELS_8BPP(tier) \
+    { blit8bpp_8_##tier, blit8bpp_16_##tier, blit8bpp_24_##tier, blit8bpp_32_##tier, blit8bppAny_##tier }
+
+/** The 8-bpp kernels of each instruction set indexed by CpuTier and mask stride (8,16,24,32,other) */
+static const GlyphKernel theKernels8bpp[NUMBER_OF_CPU_TIERS][5] = {
+    KERNELS_8BPP(generic),
+#ifdef USE_X86_SIMD
+    KERNELS_8BPP(sse2),
+    KERNELS_8BPP(avx2)
+#else
+    KERNELS_8BPP(generic),
+    KERNELS_8BPP(generic)
+#endif
+};
+
+/** The 1-bpp kernels indexed by mask stride (1,2,3,4,other), merging bits does not benefit from SIMD */
+static const GlyphKernel theKernels1bpp[5] = {
+    blit1bpp_1, blit1bpp_2, blit1bpp_3, blit1bpp_4, blit1bppAny
+};
+
+/**
+ * Returns the kernel specialized for the provided geometry or the generic kernel when there is none
+ * @param bitsPerPixel  The pixel depth of the image (1 or 8)
+ * @param maskStride    The number of bytes of each row of the glyph masks (0 = the generic kernel)
+ * @param cpuTier       The instruction set used by the kernel
+ */
+static GlyphKernel getGlyphKernel(int bitsPerPixel, int maskStride, CpuTier cpuTier) {
+    if (bitsPerPixel==1) {
+        return theKernels1bpp[ (1<=maskStride && maskStride<=4) ? maskStride-1 : 4 ];
+    }
+    return theKernels8bpp[cpuTier][ (maskStride%8==0 && 8<=maskStride && maskStride<=32) ? maskStride/8-1 : 4 ];
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > GLYPH CACHE
+
+
+
+/**
+ * Allocates a cache with the glyphs of a font expanded to 8-bpp masks
+ *
+ * Scaling is done here, once per font and scale: each pixel of the font becomes a block of
+ * `scale` x `scale` pixels in the mask, so drawing a scaled glyph costs the same as any blit.
+ * @param font          The font containing the characters
+ * @param charWidth     The width of each character in the font in pixels (maximum 8)
+ * @param charHeight    The height of each character in the font in pixels (maximum 8)
+ * @param scale         The integer magnification applied to each glyph (1 = original size)
+ * @param bitsPerPixel  The pixel depth of the images where the glyphs will be drawn (1 or 8)
+ * @returns             The new glyph cache, it must be deallocated with 'freeGlyphCache(..)' (NULL on error)
+ */
+GlyphCache * allocGlyphCache(const Font *font, int charWidth, int charHeight, int scale, int bitsPerPixel) {
+    GlyphCache *glyphs; const Byte *sour; Byte *dest;
+    int charIndex, i, j, k, segment, top, bottom;
+    assert( font!=NULL && charWidth>0 && charHeight>0 && scale>0 );
+    assert( bitsPerPixel==1 || bitsPerPixel==8 );
+    charWidth  = min(charWidth ,CHARWIDTH );
+    charHeight = min(charHeight,CHARHEIGHT);
+    
+    glyphs = malloc(sizeof(GlyphCache));
+    if (!glyphs) { return NULL; }
+    glyphs->font       = font;
+    glyphs->scale        = scale;
+    glyphs->bitsPerPixel = bitsPerPixel;
+    glyphs->charWidth    = charWidth  * scale;
+    glyphs->charHeight   = charHeight * scale;
+    glyphs->maskStride   = (bitsPerPixel==1) ? (glyphs->charWidth+7)/8 : (glyphs->charWidth+7) & ~7;
+    glyphs->glyphSize  = glyphs->maskStride * glyphs->charHeight;
+    glyphs->kernel       = getGlyphKernel(bitsPerPixel, glyphs->maskStride, getCpuTier());
+    glyphs->generic      = getGlyphKernel(bitsPerPixel, 0                 , getCpuTier());
+    glyphs->masks        = calloc(256, glyphs->glyphSize);
+    if (!glyphs->masks) { free(glyphs); return NULL; }
+    
+    for (charIndex=0; charIndex<256; ++charIndex) {
+        sour = &font->data[charIndex*CHARHEIGHT];
+        dest = &glyphs->masks[charIndex*glyphs->glyphSize];
+        top  = charHeight; bottom = 0;
+        for (j=0; j<charHeight; ++j) {
+            segment = sour[j] & (0xFF00>>charWidth);
+            if (segment) { if (j<top) { top=j; } bottom=j+1; }
+            /* expand the first scaled row and repeat it `scale` times */
+            for (i=0; i<glyphs->charWidth; ++i) {
+                if (!(segment & (0x80>>(i/scale)))) { continue; }
+                if (bitsPerPixel==1) { dest[i/8] |= (0x80>>(i&7)); } else { dest[i] = 0xFF; }
+            }
+            for (k=1; k<scale; ++k) { memcpy(&dest[k*glyphs->maskStride], dest, glyphs->maskStride); }
+            dest += scale * glyphs->maskStride;
+        }
+        glyphs->top[charIndex]    = top    * scale;
+        glyphs->bottom[charIndex] = bottom * scale;
+    }
+    return glyphs;
+}
+
+/**
+ * Deallocates a glyph cache previously allocated with 'allocGlyphCache(..)'
+ */
+void freeGlyphCache(GlyphCache *glyphs) {
+    if (!glyphs) { return; }
+    free(glyphs->masks);
+    free(glyphs);
+}
+
+/**
+ * Draws a glyph at specified position using the current color of the image
+ *
+ * In 1-bpp images any color other than zero sets the pixels of the glyph.
+ * @param image      The image where the glyph will be drawn
+ * @param x          The X coordinate of the top-left corner of the glyph
+ * @param y          The Y coordinate of the top-left corner of the glyph
+ * @param glyphs     The glyph cache containing the glyph to draw
+ * @param charIndex  The index of the character to draw (ex: 65 -> "A")
+ */
+void drawGlyph(Image *image, int x, int y, const GlyphCache *glyphs, Char256 charIndex) {
+    const int top = glyphs->top[charIndex];
+    Byte *dest; int maskStride, scanlineSize;
+    assert( image!=NULL && glyphs!=NULL );
+    assert( image->bitsPerPixel==glyphs->bitsPerPixel );
+    
+    if (isBlankGlyph(glyphs,charIndex)) { return; }
+    
+    maskStride   = glyphs->maskStride;
+    scanlineSize = image->scanlineSize;
+    if (glyphs->bitsPerPixel==1) {
+        /* 1-bpp: the specialized kernels only set pixels, clearing them needs the generic kernel */
+        dest = &image->pixelData[(size_t)(y+top)*scanlineSize + x/8];
+        (image->curColor ? glyphs->kernel : glyphs->generic)
+            (dest, &glyphs->masks[charIndex*glyphs->glyphSize + top*maskStride],
+             glyphs->bottom[charIndex]-top, maskStride, scanlineSize, maskStride, x&7, (Byte)image->curColor);
+    }
+    else {
+        /* 8-bpp: the padded rows are blended only when they fit in the scanline,
+         * near the right edge the generic kernel blends just the glyph width */
+        dest = &image->pixelData[(size_t)(y+top)*scanlineSize + x];
+        (x+maskStride <= (int)scanlineSize ? glyphs->kernel : glyphs->generic)
+            (dest, &glyphs->masks[charIndex*glyphs->glyphSize + top*maskStride],
+             glyphs->bottom[charIndex]-top, min(maskStride,(int)scanlineSize-x), scanlineSize, maskStride, 0,
+             (Byte)image->curColor);
+    }
+}
@@ -0,0 +1,112 @@
+/**
+ * @file       glyphs.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_glyphs_h
+#define bas2img_glyphs_h
+#include "globals.h"
+#include "image.h"
+
+
+/**
+ * A routine that blits the rows of a glyph mask into the pixels of an image
+ * @param dest          Pointer to the first pixel (or byte for 1-bpp images) to draw
+ * @param mask          Pointer to the first row of the glyph mask to blit
+ * @param numberOfRows  The number of rows to blit
+ * @param width         The number of bytes of each row to blit
+ * @param scanlineSize  The number of bytes from one line of pixels to the next in the image
+ * @param maskStride    The number of bytes from one row of the mask to the next
+ * @param shift         The position of the first pixel inside the first byte (only for 1-bpp images)
+ * @param color         The palette index used to draw the glyph
+ */
+typedef void (*GlyphKernel)(Byte *dest, const Byte *mask, int numberOfRows, int width,
+                            int scanlineSize, int maskStride, int shift, Byte color);
+
+/**
+ * The characters of a font expanded (and scaled) to 8-bpp masks, ready to be blitted over an image
+ *
+ * Each glyph is stored as `charHeight` rows of `maskStride` bytes, a byte is 0xFF where the
+ * pixel is set and 0x00 where it is transparent (bytes beyond `charWidth` are always 0x00).
+ * When the cache is built with a scale, `charWidth` and `charHeight` are the scaled sizes.
+ * Caches built for 1-bpp images store instead each row as packed bits (MSB = leftmost pixel).
+ * The masks do not depend on the color, the current color of the image is applied when drawing.
+ */
+typedef struct GlyphCache {
+    const Font *font;        /* < the font used to build the glyphs                     */
+    int        scale;        /* < the magnification applied to each character           */
+    int        bitsPerPixel; /* < the pixel depth of the images where glyphs are drawn  */
+    int        charWidth;    /* < width of each glyph in pixels (already scaled)        */
+    int        charHeight;   /* < height of each glyph in pixels (already scaled)       */
+    int        maskStride;   /* < number of bytes from one row of a mask to the next    */
+    int        glyphSize;    /* < number of bytes used by the mask of each glyph        */
+    int        top[256];     /* < index of the first row of each glyph with any pixel   */
+    int        bottom[256];  /* < index after the last row of each glyph with any pixel */
+    Byte       *masks;       /* < the masks of the 256 glyphs (one after the other)     */
+    GlyphKernel kernel;      /* < the blit routine specialized for the glyph geometry   */
+    GlyphKernel generic;     /* < the blit routine that handles any geometry and color  */
+} GlyphCache;
+
+/**
+ * Returns `TRUE` if the glyph does not have any pixel to draw (ex: the space character)
+ */
+#define isBlankGlyph(glyphs,charIndex) \
+    ((glyphs)->top[charIndex]>=(glyphs)->bottom[charIndex])
+
+
+/**
+ * Allocates a cache with the glyphs of a font expanded to 8-bpp masks
+ * @param font          The font containing the characters
+ * @param charWidth     The width of each character in the font in pixels (maximum 8)
+ * @param charHeight    The height of each character in the font in pixels (maximum 8)
+ * @param scale         The integer magnification applied to each glyph (1 = original size)
+ * @param bitsPerPixel  The pixel depth of the images where the glyphs will be drawn (1 or 8)
+ * @returns             The new glyph cache, it must be deallocated with 'freeGlyphCache(..)' (NULL on error)
+ */
+GlyphCache * allocGlyphCache(const Font *font, int charWidth, int charHeight, int scale, int bitsPerPixel);
+
+/**
+ * Deallocates a glyph cache previously allocated with 'allocGlyphCache(..)'
+ */
+void freeGlyphCache(GlyphCache *glyphs);
+
+/**
+ * Draws a glyph at specified position using the current color of the image
+ *
+ * In 1-bpp images any color other than zero sets the pixels of the glyph.
+ * @param image      The image where the glyph will be drawn
+ * @param x          The X coordinate of the top-left corner of the glyph
+ * @param y          The Y coordinate of the top-left corner of the glyph
+ * @param glyphs     The glyph cache containing the glyph to draw
+ * @param charIndex  The index of the character to draw (ex: 65 -> "A")
+ */
+void drawGlyph(Image *image, int x, int y, const GlyphCache *glyphs, Char256 charIndex);
+
+
+#endif /* bas2img_glyphs_h */
@@ -37,6 +37,7 @@
 #define DIR_SEPARATOR1  '\\'  /* < char used to separate directories in a path      */
 #define DIR_SEPARATOR2  '/'   /* < char used to separate directories in a path      */
 #define EXT_SEPARATOR   '.'   /* < char used as file extension separator            */
+#define PAGE_SUFFIX_LEN 16    /* < maximum length of the page suffix, ex: "-001"    */
 
 /**
  * Replaces the sign '$' contained in message with the text provided in 'str'
@@ -92,6 +93,10 @@ const utf8 * getImageExtension(ImageFormat imageFormat, const utf8* referencePat
     switch(imageFormat) {
         case BMP: return uppercase ? ".BMP" : ".bmp";
         case GIF: return uppercase ? ".GIF" : ".gif";
+        case PNG: return uppercase ? ".PNG" : ".png";
+        case TIFF: return uppercase ? ".TIF" : ".tif";
+        case SVG: return uppercase ? ".SVG" : ".svg";
+        case SIXEL: return uppercase ? ".SIX" : ".six";
         default:  return uppercase ? ".NIL" : ".nil";
     }
 }
@@ -126,6 +131,34 @@ const utf8* allocFilePath(const utf8* originalFilePath, const utf8* newExtension
     return fileName;
 }
 
+/**
+ * Allocates a string containing the provided path with a page number appended to the file name
+ *
+ * Example: ("dir/program.gif", 3) -> "dir/program-003.gif"
+ * @param filePath    The path to the file
+ * @param pageNumber  The page number to append (starting at 1)
+ * @returns
+ *      A new allocated string containing the path to the page,
+ *      it must be deallocated with 'free()'
+ */
+const utf8 * allocPageFilePath(const utf8* filePath, int pageNumber) {
+    const utf8 *ptr, *extension=NULL; utf8 *pagePath, *dest;
+    assert( filePath!=NULL && pageNumber>0 );
+    
+    for (ptr=filePath; *ptr!='\0'; ++ptr) {
+        if      (*ptr==DIR_SEPARATOR1 || *ptr==DIR_SEPARATOR2) { extension=NULL; }
+        else if (*ptr==EXT_SEPARATOR)                          { extension=ptr;  }
+    }
+    if (extension==NULL) { extension=ptr; }
+    pagePath = malloc( strlen(filePath)+PAGE_SUFFIX_LEN+1 );
+    if (!pagePath) { return NULL; }
+    memcpy(pagePath, filePath, extension-filePath);
+    dest = pagePath + (extension-filePath);
+    dest += sprintf(dest, "-%03d", pageNumber);
+    strcpy(dest, extension);
+    return pagePath;
+}
+
 /**
  * Allocates a string containing the name and extension of the file indicated by the path
  * @param filePath  The path to the file
@@ -65,6 +65,18 @@ const utf8 * allocConcatenation(const utf8 *firstString, const utf8 *secondStrin
 const utf8 * allocFilePath(const utf8* originalFilePath, const utf8* newExtension, ExtensionMethod method);
 
 
+/**
+ * Allocates a string containing the provided path with a page number appended to the file name
+ *
+ * Example: ("dir/program.gif", 3) -> "dir/program-003.gif"
+ * @param filePath    The path to the file
+ * @param pageNumber  The page number to append (starting at 1)
+ * @returns
+ *      A new allocated string containing the path to the page,
+ *      it must be deallocated with 'free()'
+ */
+const utf8 * allocPageFilePath(const utf8* filePath, int pageNumber);
+
 /**
  * Allocates a string containing the name and extension of the file indicated by the path
  * @param filePath  The path to the file
@@ -32,6 +32,9 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "image.h"
 #include "bmp.h"
 #include "gif.h"
@@ -41,6 +44,36 @@
 #define lerp256(v0, v1, t) ( ((256-t)*v0 + t*v1) / 256 )
 #define CHARWIDTH  8
 #define CHARHEIGHT 8
+#define MIN_MAPPED_SIZE (4L*1024*1024) /* < pixel data of this size or larger is memory mapped */
+
+/**
+ * Allocates a block of memory filled with zeros for the pixels of an image
+ *
+ * Large blocks are anonymous memory mappings, the system supplies the zero pages
+ * lazily when they are first written, so no memset is required and the memory
+ * used by a giant image grows only with the pixels actually drawn.
+ * @param size          The size of the block in bytes
+ * @param out_isMapped  Pointer to the variable where `TRUE` is stored if the block was mapped
+ * @returns             The block of memory or NULL if there is not enough memory
+ */
+static Byte * allocPixelData(size_t size, Bool *out_isMapped) {
+    void *data = MAP_FAILED;
+    assert( size>0 && out_isMapped!=NULL );
+    
+    if (size>=MIN_MAPPED_SIZE) {
+#if defined(MAP_ANONYMOUS)
+        data = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+#elif defined(MAP_ANON)
+        data = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+#else
+        /* strict POSIX: a private mapping of /dev/zero behaves as an anonymous mapping */
+        int fd = open("/dev/zero", O_RDWR);
+        if (fd>=0) { data = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0); close(fd); }
+#endif
+    }
+    (*out_isMapped) = (data!=MAP_FAILED);
+    return (data!=MAP_FAILED) ? (Byte*)data : (Byte*)calloc(size,1);
+}
 
 
 /**
@@ -49,24 +82,71 @@
  * @param height        The height of the image
  */
 Image * allocImage(int width, int height) {
+    return allocImageWithDepth(width, height, 8);
+}
+
+/**
+ * Allocates a new image with a specific size and pixel depth
+ * @param width         The width of the image
+ * @param height        The height of the image
+ * @param bitsPerPixel  The number of bits of each pixel (valid values: 1 or 8)
+ */
+Image * allocImageWithDepth(int width, int height, int bitsPerPixel) {
     Image *image; int scanlineSize;
     assert( width>0 && height>0 );
+    assert( bitsPerPixel==1 || bitsPerPixel==8 );
     
     /* the most compatible scanline size */
-    scanlineSize = getBmpScanlineSize2(width,8);
+    scanlineSize = getBmpScanlineSize2(width,bitsPerPixel);
     
     image = malloc(sizeof(Image));
+    if (!image) { return NULL; }
     image->width          = width;
     image->height         = height;
+    image->bitsPerPixel   = bitsPerPixel;
     image->scanlineSize   = scanlineSize;
-    image->colorTableSize = 256 * 4 * sizeof(Byte);
+    image->colorTableSize = (1<<bitsPerPixel) * 4 * sizeof(Byte);
     image->colorTable     = malloc(image->colorTableSize);
-    image->pixelDataSize  = image->height * image->scanlineSize;
-    image->pixelData      = malloc(image->pixelDataSize);
-    image->curColor       = 255;
+    image->pixelDataSize  = (size_t)image->height * image->scanlineSize;
+    image->pixelData      = allocPixelData(image->pixelDataSize, &image->isMapped);
+    image->isExternal     = FALSE;
+    image->curColor       = (1<<bitsPerPixel)-1;
+    image->curFont        = NULL;
+    if (!image->colorTable || !image->pixelData) { freeImage(image); return NULL; }
+    memset(image->colorTable,0,image->colorTableSize);
+    return image;
+}
+
+/**
+ * Allocates a new image that stores its palette and its pixels in memory provided by the caller
+ * @param width         The width of the image
+ * @param height        The height of the image
+ * @param bitsPerPixel  The number of bits of each pixel (valid values: 1 or 8)
+ * @param colorTable    The buffer for the palette, 4 bytes for each of the `1<<bitsPerPixel` colors
+ * @param pixelData     The buffer for the pixels, `height` scanlines of 'getBmpScanlineSize2(..)' bytes
+ * @returns             The new image or NULL if there is not enough memory
+ */
+Image * allocImageWithPixels(int width, int height, int bitsPerPixel, Byte *colorTable, Byte *pixelData) {
+    Image *image;
+    assert( width>0 && height>0 );
+    assert( bitsPerPixel==1 || bitsPerPixel==8 );
+    assert( colorTable!=NULL && pixelData!=NULL );
+    
+    image = malloc(sizeof(Image));
+    if (!image) { return NULL; }
+    image->width          = width;
+    image->height         = height;
+    image->bitsPerPixel   = bitsPerPixel;
+    image->scanlineSize   = getBmpScanlineSize2(width,bitsPerPixel);
+    image->colorTableSize = (1<<bitsPerPixel) * 4 * sizeof(Byte);
+    image->colorTable     = colorTable;
+    image->pixelDataSize  = (size_t)image->height * image->scanlineSize;
+    image->pixelData      = pixelData;
+    image->isMapped       = FALSE;
+    image->isExternal     = TRUE;
+    image->curColor       = (1<<bitsPerPixel)-1;
     image->curFont        = NULL;
     memset(image->colorTable,0,image->colorTableSize);
-    memset(image->pixelData,0,image->pixelDataSize);
     return image;
 }
 
@@ -74,8 +154,11 @@ Image * allocImage(int width, int height) {
  * Deallocate an image previously allocated with 'allocImage(..)'
  */
 void freeImage(Image *image) {
+    if (!image) { return; }
+    if (image->isExternal) { free(image); return; }
     free(image->colorTable);
-    free(image->pixelData);
+    if (image->isMapped) { munmap(image->pixelData, image->pixelDataSize); }
+    else                 { free(image->pixelData); }
     free(image);
 }
 
@@ -87,6 +170,7 @@ void freeImage(Image *image) {
 void setPaletteGradient(Image *image, int index0, Rgb rgb0, int index1, Rgb rgb1) {
     const int range = index1-index0;
     int i,t; Byte *ptr;
+    assert( image!=NULL && 0<=index0 && index1<(int)(image->colorTableSize/4) );
 
     ptr = &image->colorTable[4*index0];
     for (i=0; i<=range; ++i) {
@@ -98,6 +182,44 @@ void setPaletteGradient(Image *image, int index0, Rgb rgb0, int index1, Rgb rgb1
     }
 }
 
+void setPaletteColor(Image *image, int index, Rgb rgb) {
+    Byte *ptr;
+    assert( image!=NULL && 0<=index && index<(int)(image->colorTableSize/4) );
+    ptr = &image->colorTable[4*index];
+    ptr[0]=rgb.b; ptr[1]=rgb.g; ptr[2]=rgb.r; ptr[3]=0;
+}
+
+/**
+ * Fills a font with the characters of other font rotated 90 degrees clockwise
+ *
+ * Each rotated character is `charHeight` pixels wide and `charWidth` pixels tall, so it can
+ * be drawn directly with 'drawChar(..)' to generate images with vertical orientation.
+ * @param rotatedFont  The font where the rotated characters will be stored
+ * @param font         The original font
+ * @param charWidth    The width of each original character in pixels (maximum 8)
+ * @param charHeight   The height of each original character in pixels (maximum 8)
+ */
+void initRotatedFont(Font *rotatedFont, const Font *font, int charWidth, int charHeight) {
+    int charIndex, u, v, segment; const Byte *sour; Byte *dest;
+    assert( rotatedFont!=NULL && font!=NULL );
+    charWidth  = min(charWidth ,CHARWIDTH );
+    charHeight = min(charHeight,CHARHEIGHT);
+    
+    rotatedFont->name        = font->name;
+    rotatedFont->description = font->description;
+    memset(rotatedFont->data, 0, sizeof(rotatedFont->data));
+    for (charIndex=0; charIndex<256; ++charIndex) {
+        sour = &font->data[charIndex*CHARHEIGHT];
+        dest = &rotatedFont->data[charIndex*CHARHEIGHT];
+        /* transpose the 8x8 block: rotated pixel (u,v) comes from original pixel (v,charHeight-1-u) */
+        for (u=0; u<charHeight; ++u) {
+            segment = sour[charHeight-1-u];
+            for (v=0; v<charWidth; ++v) {
+                if (segment & (0x80>>v)) { dest[v] |= (0x80>>u); }
+            }
+        }
+    }
+}
 
 void setColor(Image *image, int color) {
     assert( image!=NULL );
@@ -124,13 +246,13 @@ void drawChar(Image *image, int x, int y, int maxWidth, int maxHeight, Char256 c
     int i, j, segment, mask, color, scanlineSize;
     const int charWidth  = min(maxWidth ,CHARWIDTH );
     const int charHeight = min(maxHeight,CHARHEIGHT);
-    assert( image!=NULL );
+    assert( image!=NULL && image->bitsPerPixel==8 );
     
     if (!image->curFont) { return; }
     
     scanlineSize = image->scanlineSize;
     sour         = &image->curFont->data[charIndex*CHARHEIGHT];
-    dest         = &image->pixelData[y*scanlineSize + x];
+    dest         = &image->pixelData[(size_t)y*scanlineSize + x];
     color        = image->curColor;
     for (j=0; j<charHeight; ++j) {
         segment=*sour++; mask=0x80;
@@ -144,6 +266,7 @@ void drawChar(Image *image, int x, int y, int maxWidth, int maxHeight, Char256 c
 
 void fillRectangle(Image *image, int left, int top, int right, int bottom) {
     Byte *ptr; int width, height, scanlineSize, color, temp;
+    assert( image!=NULL && image->bitsPerPixel==8 );
     
     /* fix rectangles with inverted coordinates */
     if (left>right) { swap(left,right); }
@@ -160,7 +283,7 @@ void fillRectangle(Image *image, int left, int top, int right, int bottom) {
     if (width>0) {
         scanlineSize = image->scanlineSize;
         color        = image->curColor;
-        ptr          = &image->pixelData[top*scanlineSize + left];
+        ptr          = &image->pixelData[(size_t)top*scanlineSize + left];
         height=bottom-top; while (height-->0) {
             memset(ptr,color,width);
             ptr += scanlineSize;
@@ -170,23 +293,20 @@ void fillRectangle(Image *image, int left, int top, int right, int bottom) {
 
 
 /*=================================================================================================================*/
-#pragma mark - > WRITTING IMAGE TO A FILE
-
-Bool fwriteBmpImage(Image *image, FILE *file) {
-    static const int bitsPerPixel = 8;
-    assert( image!=NULL && file!=NULL );
-    return fwriteBmp(image->width, image->height, image->scanlineSize, bitsPerPixel,
-                     image->colorTable, image->colorTableSize,
-                     image->pixelData , image->pixelDataSize,
-                     file);
-}
+#pragma mark - > WRITTING IMAGE TO A SINK
 
-Bool fwriteGifImage(Image *image, FILE *file) {
-    static const int bitsPerPixel = 8;
-    assert( image!=NULL && file!=NULL );
-    return fwriteGif(image->width, image->height, image->scanlineSize, bitsPerPixel,
-                     image->colorTable, image->colorTableSize,
-                     image->pixelData , image->pixelDataSize,
-                     file);
+Bool writeBmpImage(Image *image, ByteSink *sink) {
+    assert( image!=NULL && sink!=NULL );
+    return writeBmp(image->width, image->height, image->scanlineSize, image->bitsPerPixel,
+                    image->colorTable, image->colorTableSize,
+                    image->pixelData , image->pixelDataSize,
+                    sink);
 }
 
+Bool writeGifImage(Image *image, ByteSink *sink) {
+    assert( image!=NULL && sink!=NULL );
+    return writeGif(image->width, image->height, image->scanlineSize, image->bitsPerPixel,
+                    image->colorTable, image->colorTableSize,
+                    image->pixelData , image->pixelDataSize,
+                    sink);
+}
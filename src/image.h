@@ -33,16 +33,20 @@
 #define bas2img_image_h
 #include <stdio.h>
 #include "globals.h"
+#include "sink.h"
 
 
 typedef struct Image {
     unsigned  width;
     unsigned  height;
+    unsigned  bitsPerPixel;  /* < 8 = one palette index per byte, 1 = packed monochrome pixels (MSB first) */
     unsigned  scanlineSize;
     Byte     *colorTable;
     unsigned  colorTableSize;
     Byte     *pixelData;
-    unsigned  pixelDataSize;
+    size_t    pixelDataSize; /* < the size of `pixelData` in bytes (it can exceed 4GB)          */
+    Bool      isMapped;      /* < TRUE = `pixelData` is an anonymous memory mapping (lazy zero pages) */
+    Bool      isExternal;    /* < TRUE = `colorTable` and `pixelData` belong to the caller (ex: a mapped file) */
     
     int         curColor;  /* < current color (palette index) */
     const Font *curFont;   /* < current font (NULL = none) */
@@ -59,6 +63,28 @@ typedef struct Image {
  */
 Image * allocImage(int width, int height);
 
+/**
+ * Allocates a new image with a specific size and pixel depth
+ * @param width         The width of the image
+ * @param height        The height of the image
+ * @param bitsPerPixel  The number of bits of each pixel (valid values: 1 or 8)
+ * @returns             The new image or NULL if there is not enough memory
+ */
+Image * allocImageWithDepth(int width, int height, int bitsPerPixel);
+
+/**
+ * Allocates a new image that stores its palette and its pixels in memory provided by the caller
+ *
+ * The memory must stay valid while the image is used and it is not released by 'freeImage(..)'.
+ * @param width         The width of the image
+ * @param height        The height of the image
+ * @param bitsPerPixel  The number of bits of each pixel (valid values: 1 or 8)
+ * @param colorTable    The buffer for the palette, 4 bytes for each of the `1<<bitsPerPixel` colors
+ * @param pixelData     The buffer for the pixels, `height` scanlines of 'getBmpScanlineSize2(..)' bytes
+ * @returns             The new image or NULL if there is not enough memory
+ */
+Image * allocImageWithPixels(int width, int height, int bitsPerPixel, Byte *colorTable, Byte *pixelData);
+
 /**
  * Deallocate an image previously allocated with 'allocImage(..)'
  */
@@ -71,6 +97,20 @@ void freeImage(Image *image);
 
 void setPaletteGradient(Image *image, int index0, Rgb rgb0, int index1, Rgb rgb1);
 
+void setPaletteColor(Image *image, int index, Rgb rgb);
+
+/**
+ * Fills a font with the characters of other font rotated 90 degrees clockwise
+ *
+ * Each rotated character is `charHeight` pixels wide and `charWidth` pixels tall, so it can
+ * be drawn directly with 'drawChar(..)' to generate images with vertical orientation.
+ * @param rotatedFont  The font where the rotated characters will be stored
+ * @param font         The original font
+ * @param charWidth    The width of each original character in pixels (maximum 8)
+ * @param charHeight   The height of each original character in pixels (maximum 8)
+ */
+void initRotatedFont(Font *rotatedFont, const Font *font, int charWidth, int charHeight);
+
 void setColor(Image *image, int color);
 
 void setFont(Image *image, const Font *font);
@@ -90,12 +130,12 @@ void fillRectangle(Image *image, int x0, int y0, int x1, int y1);
 
 
 /*=================================================================================================================*/
-#pragma mark - > WRITTING IMAGE TO A FILE
+#pragma mark - > WRITTING IMAGE TO A SINK
 
 
-Bool fwriteBmpImage(Image *image, FILE *file);
+Bool writeBmpImage(Image *image, ByteSink *sink);
 
-Bool fwriteGifImage(Image *image, FILE *file);
+Bool writeGifImage(Image *image, ByteSink *sink);
 
 
 #endif /* bas2img_image_h */
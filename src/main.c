@@ -42,6 +42,7 @@
 #include "export.h"
 #include "bmp.h"
 #include "gif.h"
+#include "cpu.h"
 #define VERSION   "0.1"
 #define COPYRIGHT "Copyright (c) 2020 Martin Rizzo"
 
@@ -55,6 +56,12 @@
 #define isOption(param,nameToCheck1,nameToCheck2) \
     (strcmp(param,nameToCheck1)==0 || strcmp(param,nameToCheck2)==0)
 
+/**
+ * Returns `TRUE` if param is equal to the provided name of an option that has no short form
+ */
+#define isLongOption(param,nameToCheck) \
+    (strcmp(param,nameToCheck)==0)
+
 /**
  * Returns `TRUE` if command is equal to the provided name
  */
@@ -76,6 +83,60 @@ static const utf8 * getOptionCfg(int *inout_index, int argc, char* argv[]) {
     return nextparam;
 }
 
+/**
+ * Returns `TRUE` if param is the provided option written as "--name=<value>" or "--name <value>"
+ */
+#define isOptionWithValue(param,name) \
+    (strncmp(param,name,strlen(name))==0 && (param[strlen(name)]=='=' || param[strlen(name)]=='\0'))
+
+/**
+ * Returns the value of an option written as "--name=<value>" or as "--name <value>"
+ */
+static const utf8 * getOptionValue(const utf8 *param, int *inout_index, int argc, char* argv[]) {
+    const utf8 *equal = strchr(param,'=');
+    return equal ? equal+1 : getOptionCfg(inout_index,argc,argv);
+}
+
+/**
+ * Reads a size in the format "<width>x<height>", any of both values can be omitted (ex: "640x", "x480")
+ * @param str         The string containing the size
+ * @param out_width   Pointer to the variable where the width will be stored (0 = omitted)
+ * @param out_height  Pointer to the variable where the height will be stored (0 = omitted)
+ */
+static void parseSize(const utf8 *str, int *out_width, int *out_height) {
+    assert( str!=NULL && out_width!=NULL && out_height!=NULL );
+    (*out_width)  = atoi(str);
+    while (*str!='\0' && *str!='x' && *str!='X') { ++str; }
+    (*out_height) = (*str!='\0') ? atoi(str+1) : 0;
+}
+
+/**
+ * Reads a ratio in the format "<width>:<height>" or as a single decimal number (ex: "16:9", "1.5")
+ * @param str  The string containing the ratio
+ * @returns    The ratio value or zero if the string does not contain a valid ratio
+ */
+static double parseRatio(const utf8 *str) {
+    double width, height;
+    assert( str!=NULL );
+    width = atof(str);
+    while (*str!='\0' && *str!=':') { ++str; }
+    height = (*str!='\0') ? atof(str+1) : 1.0;
+    return (width>0 && height>0) ? width/height : 0.0;
+}
+
+/**
+ * Reads a scale factor, integer values use pre-scaled glyphs and fractional values use filtering
+ * @param str     The string containing the scale (ex: "2", "1.5")
+ * @param config  The configuration where the scale will be stored
+ */
+static void parseScale(const utf8 *str, Config *config) {
+    double scale;
+    assert( str!=NULL && config!=NULL );
+    scale = atof(str);
+    config->charScale       = (scale>0 && scale==(int)scale) ? (int)scale : 0;
+    config->fractionalScale = (scale>0 && scale!=(int)scale) ? scale      : 0.0;
+}
+
 /**
  * Prints the provided text lines to stdout
  * @param helpTextLines  An array of strings containing each text line to print
@@ -85,6 +146,7 @@ static Bool printHelp(const utf8** helpTextLines, Bool isMainHelp) {
     int i; static const utf8 *mainHelpFooterLines[] = {
         "",
         "LIST OF COMMANDS:",
+        "   diff              draw the differences between two versions of a program",
         "   list-computers    list names of available computers",
         "   list-fonts        list available computer fonts",
         "   export-font       draw the specified font into an image",
@@ -110,45 +172,43 @@ static Bool printVersion(void) {
 #pragma mark - > SUB-COMMANDS
 
 /**
- * Handles the command to generate the image of the BASIC program source
- * @param argc  The number of elements in the 'argv'
- * @param argv  An array containing each command-line parameter (starting at argv[1])
- * @returns     `TRUE` if the image is generated successfully
+ * Processes the command-line parameters shared by the commands that generate images of BASIC programs
+ * @param argc           The number of elements in the 'argv'
+ * @param argv           An array containing each command-line parameter (starting at argv[1])
+ * @param help           The help text lines of the command
+ * @param numberOfFiles  The number of BASIC files that the command requires (1 = image, 2 = diff)
+ * @returns              `TRUE` if the image is generated successfully
  */
-static int cmdGenerateImage(int argc, char* argv[]) {
+static Bool generateFromCommandLine(int argc, char* argv[], const utf8 **help, int numberOfFiles) {
     int i; const utf8 *param; Config config;
-    static const utf8 *help[] = {
-        "USAGE:",
-        "   bas2img <computer-name> [options] file.bas",
-        "   bas2img <command> [options]"
-        "",
-        "  OPTIONS:",
-        "    -b  --bmp                generate BMP image",
-        "    -c  --char-width <n>     width of each character in pixels (default = 8)",
-        "    -l  --line-length <n>    maximum number of character per line (default = 0)",
-        "    -w  --wrap               wrap long lines",
-        "    -s  --scale <n>          scale each character by <n>",
-        "    -f  --font <font-name>   force to use a specific font",
-        "    -H  --horizontal         use horizontal orientation (default)",
-        "    -V  --vertical           use vertical orientation",
-        "    -o  --output <file>      write the generated image to <file>",
-        "    -h, --help               display this help and exit",
-        "    -v, --version            output version information and exit",
-        NULL
-    };
     const utf8 *computerName   = NULL;
     const utf8 *fontName       = NULL;
-    const utf8 *basicFilePath  = NULL;
+    const utf8 *basicFilePaths[2] = { NULL, NULL };
     const utf8 *outputFilePath = NULL;
+    int    fileCount           = 0;
     Bool   printHelpAndExit    = (argc<=1);
     Bool   printVersionAndExit = FALSE;
+    assert( argv!=NULL && help!=NULL );
+    assert( 1<=numberOfFiles && numberOfFiles<=2 );
     config.charWidth    = 0; /* < 0 = use computer default */
     config.charHeight   = 0; /* < 0 = use computer default */
     config.charScale    = 0; /* < 0 = use computer default */
+    config.fractionalScale = 0.0;
+    config.pixelAspect  = 0.0;
     config.margin       = 0;
     config.padding      = 0;
     config.lineWidth    = 0;
     config.lineWrapping = FALSE;
+    config.rowsPerPage  = 0;
+    config.animationRows = 0;
+    config.fitWidth     = 0;
+    config.fitHeight    = 0;
+    config.aspectRatio  = 0.0;
+    config.highlighting = FALSE;
+    config.monochrome   = FALSE;
+    config.numberOfThreads = 0;
+    config.thumbnail    = FALSE;
+    config.rleCompression = FALSE;
     config.imageFormat  = GIF;
     config.orientation  = HORIZONTAL;
     config.computer     = NULL;
@@ -156,35 +216,142 @@ static int cmdGenerateImage(int argc, char* argv[]) {
     /* process all parameters */
     for (i=1; i<argc; ++i) { param=argv[i];
         if ( firstChar(param)!='-' ) {
-            if ( computerName==NULL) { computerName  = param; }
-            else                     { basicFilePath = param; }
+            if      ( computerName==NULL) { computerName = param; }
+            else if ( fileCount<numberOfFiles ) { basicFilePaths[fileCount++] = param; }
+            else    { basicFilePaths[numberOfFiles-1] = param; }
         }
         else if ( isOption(param,"-b","--bmp"        ) ) { config.imageFormat=BMP;          }
+        else if ( isOption(param,"-P","--png"        ) ) { config.imageFormat=PNG;          }
+        else if ( isOption(param,"-G","--tiff"       ) ) { config.imageFormat=TIFF;         }
+        else if ( isOption(param,"-S","--svg"        ) ) { config.imageFormat=SVG;          }
+        else if ( isLongOption(param,"--sixel"       ) ) { config.imageFormat=SIXEL;        }
+        else if ( isOption(param,"-R","--rle"        ) ) { config.imageFormat=BMP; config.rleCompression=TRUE; }
         else if ( isOption(param,"-c","--char-width" ) ) { config.charWidth=atoi(getOptionCfg(&i,argc,argv)); }
         else if ( isOption(param,"-l","--line-length") ) { config.lineWidth=atoi(getOptionCfg(&i,argc,argv)); }
         else if ( isOption(param,"-w","--wrap"       ) ) { config.lineWrapping=TRUE; }
-        else if ( isOption(param,"-s","--scale"      ) ) { config.charScale=atoi(getOptionCfg(&i,argc,argv)); }
+        else if ( isOption(param,"-r","--rows-per-page") ) { config.rowsPerPage=atoi(getOptionCfg(&i,argc,argv)); }
+        else if ( isOption(param,"-A","--animate"    ) ) { config.animationRows=atoi(getOptionCfg(&i,argc,argv)); }
+        else if ( isOption(param,"-F","--fit"        ) ) { parseSize(getOptionCfg(&i,argc,argv),&config.fitWidth,&config.fitHeight); }
+        else if ( isOption(param,"-a","--aspect"     ) ) { config.aspectRatio=parseRatio(getOptionCfg(&i,argc,argv)); }
+        else if ( isOption(param,"-s","--scale"      ) ) { parseScale(getOptionCfg(&i,argc,argv),&config); }
+        else if ( isOption(param,"-p","--pixel-aspect") ) { config.pixelAspect=parseRatio(getOptionCfg(&i,argc,argv)); }
+        else if ( isOption(param,"-x","--highlight"  ) ) { config.highlighting=TRUE; }
+        else if ( isOption(param,"-m","--mono"       ) ) { config.monochrome=TRUE;   }
+        else if ( isOption(param,"-T","--thumbnail"  ) ) { config.thumbnail=TRUE;    }
+        else if ( isOption(param,"-t","--threads"    ) ) { config.numberOfThreads=atoi(getOptionCfg(&i,argc,argv)); }
         else if ( isOption(param,"-f","--font"       ) ) { fontName = getOptionCfg(&i,argc,argv); }
         else if ( isOption(param,"-H","--horizontal" ) ) { config.orientation=HORIZONTAL;   }
         else if ( isOption(param,"-V","--vertical"   ) ) { config.orientation=VERTICAL;     }
-        else if ( isOption(param,"-o","--output"     ) ) { outputFilePath=param; }
+        else if ( isOption(param,"-o","--output"     ) ) { outputFilePath=getOptionCfg(&i,argc,argv); }
+        else if ( isOptionWithValue(param,"--cpu"     ) ) {
+            if (!forceCpuTier(getOptionValue(param,&i,argc,argv))) { return error(ERR_UNKNOWN_PARAM,param); }
+        }
         else if ( isOption(param,"-h","--help"       ) ) { printHelpAndExit=TRUE;    }
         else if ( isOption(param,"-v","--version"    ) ) { printVersionAndExit=TRUE; }
         else    { return error(ERR_UNKNOWN_PARAM,param); }
     }
+    /* the animations are always GIF, whatever the position of the format options */
+    if (config.animationRows>0) { config.imageFormat=GIF; config.rleCompression=FALSE; }
     
-    if      ( printHelpAndExit    ) { return printHelp(help,TRUE); }
-    else if ( printVersionAndExit ) { return printVersion();       }
+    if      ( printHelpAndExit    ) { return printHelp(help,numberOfFiles==1); }
+    else if ( printVersionAndExit ) { return printVersion();                   }
     
     if (!computerName) { return error(ERR_MISSING_COMPUTER_NAME,0); }
     config.computer = getComputer(computerName);
     if (!config.computer) { return error(ERR_NONEXISTENT_COMPUTER,computerName); }
     
-    if (!basicFilePath) { return error(ERR_MISSING_BAS_PATH,0); }
-    generateImageFromBASIC(outputFilePath, basicFilePath, &config);
+    if (fileCount<numberOfFiles) { return error(ERR_MISSING_BAS_PATH,0); }
+    if (numberOfFiles==2) { generateDiffImageFromBASIC(outputFilePath, basicFilePaths[0], basicFilePaths[1], &config); }
+    else                  { generateImageFromBASIC(outputFilePath, basicFilePaths[0], &config);                      }
     return success ? TRUE : FALSE;
 }
 
+/**
+ * Handles the command to generate the image of the BASIC program source
+ * @param argc  The number of elements in the 'argv'
+ * @param argv  An array containing each command-line parameter (starting at argv[1])
+ * @returns     `TRUE` if the image is generated successfully
+ */
+static int cmdGenerateImage(int argc, char* argv[]) {
+    static const utf8 *help[] = {
+        "USAGE:",
+        "   bas2img <computer-name> [options] file.bas",
+        "   bas2img <command> [options]"
+        "",
+        "  OPTIONS:",
+        "    -b  --bmp                generate BMP image",
+        "    -P  --png                generate PNG image",
+        "    -G  --tiff               generate bilevel TIFF image (CCITT G4 compression)",
+        "    -S  --svg                generate SVG image (vector glyphs, any scale)",
+        "        --sixel              write the image in DEC sixel format to the terminal (or to the -o file)",
+        "    -R  --rle                generate BMP image compressed with RLE",
+        "    -c  --char-width <n>     width of each character in pixels (default = 8)",
+        "    -l  --line-length <n>    maximum number of character per line (default = 0)",
+        "    -w  --wrap               wrap long lines",
+        "    -r  --rows-per-page <n>  split the listing in numbered images of <n> rows",
+        "    -A  --animate <n>        generate a GIF listing the rows one by one in screens of <n> rows (overrides the format)",
+        "    -F  --fit <w>x<h>        wrap lines to best fit the image into <w>x<h> pixels",
+        "    -a  --aspect <w>:<h>     wrap lines to get an image with the <w>:<h> aspect ratio",
+        "    -s  --scale <n>          scale each character by <n> (ex: 2, 1.5)",
+        "    -p  --pixel-aspect <r>   width:height ratio of the pixels of the font (ex: 4:3)",
+        "    -x  --highlight          highlight keywords, strings, numbers and comments",
+        "    -m  --mono               generate a two colors image with 1 bit per pixel",
+        "    -T  --thumbnail          generate a small overview with one pixel per character",
+        "    -f  --font <font-name>   force to use a specific font",
+        "    -H  --horizontal         use horizontal orientation (default)",
+        "    -V  --vertical           use vertical orientation",
+        "    -o  --output <file>      write the generated image to <file>",
+        "    -t  --threads <n>        number of threads used to draw the image (default = 1 per cpu)",
+        "        --cpu=<tier>         force the SIMD code used: generic, sse2 or avx2",
+        "    -h, --help               display this help and exit",
+        "    -v, --version            output version information and exit",
+        NULL
+    };
+    return generateFromCommandLine(argc, argv, help, 1);
+}
+
+/**
+ * Handles the command to generate an image with the differences between two versions of a BASIC program (diff)
+ * @param argc  The number of elements in the 'argv'
+ * @param argv  An array containing each command-line parameter (starting at argv[1])
+ * @returns     `TRUE` if the image is generated successfully
+ */
+static int cmdDiff(int argc, char* argv[]) {
+    static const utf8 *help[] = {
+        "USAGE:",
+        "   bas2img diff <computer-name> [options] old.bas new.bas",
+        "",
+        "  The new version of the program is drawn with the lines added (green),",
+        "  removed (red) and changed (amber) since the old version highlighted.",
+        "",
+        "  OPTIONS:",
+        "    -b  --bmp                generate BMP image",
+        "    -P  --png                generate PNG image",
+        "    -G  --tiff               generate bilevel TIFF image (CCITT G4 compression)",
+        "    -S  --svg                generate SVG image (vector glyphs, any scale)",
+        "        --sixel              write the image in DEC sixel format to the terminal (or to the -o file)",
+        "    -R  --rle                generate BMP image compressed with RLE",
+        "    -l  --line-length <n>    maximum number of character per line (default = 0)",
+        "    -w  --wrap               wrap long lines",
+        "    -r  --rows-per-page <n>  split the listing in numbered images of <n> rows",
+        "    -A  --animate <n>        generate a GIF listing the rows one by one in screens of <n> rows (overrides the format)",
+        "    -F  --fit <w>x<h>        wrap lines to best fit the image into <w>x<h> pixels",
+        "    -a  --aspect <w>:<h>     wrap lines to get an image with the <w>:<h> aspect ratio",
+        "    -s  --scale <n>          scale each character by <n> (ex: 2, 1.5)",
+        "    -p  --pixel-aspect <r>   width:height ratio of the pixels of the font (ex: 4:3)",
+        "    -x  --highlight          highlight keywords, strings, numbers and comments",
+        "    -T  --thumbnail          generate a small overview with one pixel per character",
+        "    -H  --horizontal         use horizontal orientation (default)",
+        "    -V  --vertical           use vertical orientation",
+        "    -o  --output <file>      write the generated image to <file>",
+        "    -t  --threads <n>        number of threads used to draw the image (default = 1 per cpu)",
+        "        --cpu=<tier>         force the SIMD code used: generic, sse2 or avx2",
+        "    -h, --help               display this help and exit",
+        NULL
+    };
+    return generateFromCommandLine(argc, argv, help, 2);
+}
+
 /**
  * Handles the command to prints the list of available computers (list-computers)
  * @param argc  The number of elements in the 'argv'
@@ -359,6 +526,7 @@ static Bool cmdImportFont(int argc, char* argv[]) {
  */
 int main(int argc, char* argv[]) {
     const utf8* const command = argc>1 ? argv[1] : "";
+    initCpuTier();
     
     /* handle commands */
     if      (isCommand(command,"list-computers")) { cmdListComputers(argc-1, argv+1); }
@@ -366,8 +534,10 @@ int main(int argc, char* argv[]) {
     else if (isCommand(command,"import-font"   )) { cmdImportFont   (argc-1, argv+1); }
     else if (isCommand(command,"export-font"   )) { cmdExportFont   (argc-1, argv+1); }
     else if (isCommand(command,"generate-image")) { cmdGenerateImage(argc-1, argv+1); }
+    else if (isCommand(command,"diff"          )) { cmdDiff         (argc-1, argv+1); }
     else                                          { cmdGenerateImage(argc, argv);     }
-    return printErrorMessage();
+    /* nothing is printed on success, the image may have been written to stdout (--sixel) */
+    return success ? ERR_NO_ERROR : printErrorMessage();
 }
 
 
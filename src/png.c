@@ -0,0 +1,339 @@
+/**
+ * @file       png.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "png.h"
+#include "threads.h"
+#define BLOCK_SIZE       (128L*1024) /* < approximate amount of filtered data compressed by each job      */
+#define DICTIONARY_SIZE  (32L*1024)  /* < size of the deflate window primed with the previous data         */
+#define ZLIB_HEADER_SIZE 2           /* < size of the zlib header that precedes the deflate data           */
+#define ADLER_SIZE       4           /* < size of the adler-32 checksum that follows the deflate data      */
+#define FILTER_NONE      0           /* < png filter type: the scanline is stored as is                     */
+#define FILTER_UP        2           /* < png filter type: each byte minus the byte above it                  */
+#define min(a,b)    ((a)<(b) ? (a) : (b))
+
+typedef struct PngJob {
+    const Byte   *lines;          /* < the packed scanlines of the block                                  */
+    const Byte   *prevLine;       /* < the packed scanline above the first one (NULL = top of the image)   */
+    int           numberOfLines;  /* < the number of scanlines in the block                               */
+    int           lineSize;       /* < the number of bytes of each packed scanline                        */
+    int           bitDepth;       /* < the number of bits of each pixel in the packed scanlines           */
+    Byte         *filtered;       /* < the filtered scanlines, each one preceded by its filter type       */
+    const Byte   *dictionary;     /* < the filtered data that precedes the block in the zlib stream       */
+    long          dictionarySize; /* < the number of bytes in `dictionary` (0 = none)                     */
+    Bool          isLast;         /* < TRUE = the block contains the last scanline of the image           */
+    Byte         *buffer;         /* < room for the zlib header + the compressed data + the adler-32      */
+    long          capacity;       /* < the maximum number of compressed bytes that fit in `buffer`        */
+    long          outputSize;     /* < the number of compressed bytes stored after the zlib header room    */
+    unsigned long adler;          /* < the adler-32 checksum of the filtered data of the block            */
+    Bool          hasFailed;      /* < TRUE = the compression of the block failed                         */
+} PngJob;
+
+
+/*=================================================================================================================*/
+#pragma mark - > FILTERING
+
+/**
+ * Counts the number of bytes that differ from the byte before them
+ *
+ * Rendered text is made of long runs of the same palette index, a line
+ * with fewer transitions produces longer matches for the deflate stage.
+ */
+static long countTransitions(const Byte *line, int lineSize) {
+    long count = 0; int x;
+    for (x=1; x<lineSize; ++x) { if (line[x]!=line[x-1]) { ++count; } }
+    return count;
+}
+
+/**
+ * Filters a scanline choosing the filter type per line
+ *
+ * Palette indices are not intensities, so the arithmetic filters (Sub, Average,
+ * Paeth) only scramble the runs; with less than 8 bits per pixel several pixels
+ * share each byte and even Up rarely helps, in that case the filter is always None.
+ * With 8 bits per pixel the line is stored with Up when that leaves fewer
+ * transitions than the unfiltered line (ex: the edges of scaled glyphs that
+ * repeat from the line above).
+ * @param dest      The buffer where the filter type followed by the `lineSize` filtered bytes will be stored
+ * @param line      The packed scanline to filter
+ * @param prevLine  The packed scanline above `line` (NULL = top of the image)
+ * @param lineSize  The number of bytes of each packed scanline
+ * @param bitDepth  The number of bits of each pixel in the packed scanline
+ */
+static void filterLine(Byte *dest, const Byte *line, const Byte *prevLine, int lineSize, int bitDepth) {
+    int x;
+    
+    if (bitDepth==8 && prevLine) {
+        for (x=0; x<lineSize; ++x) { dest[x+1] = (Byte)(line[x]-prevLine[x]); }
+        if (countTransitions(&dest[1],lineSize) < countTransitions(line,lineSize)) {
+            dest[0] = FILTER_UP;
+            return;
+        }
+    }
+    dest[0] = FILTER_NONE;
+    memcpy(&dest[1], line, lineSize);
+}
+
+/**
+ * Filters the scanlines of a block (this function is executed by the worker threads)
+ * @param job  Pointer to the `PngJob` structure describing the block
+ */
+static void filterBlock(void *job) {
+    PngJob *block = (PngJob*)job; int i; const Byte *line, *prevLine; Byte *dest;
+    assert( block!=NULL && block->lines!=NULL && block->filtered!=NULL );
+    
+    prevLine = block->prevLine;
+    dest     = block->filtered;
+    for (i=0; i<block->numberOfLines; ++i) {
+        line = &block->lines[(long)i*block->lineSize];
+        filterLine(dest, line, prevLine, block->lineSize, block->bitDepth);
+        prevLine = line;
+        dest    += block->lineSize+1;
+    }
+}
+
+/**
+ * Compresses the filtered scanlines of a block (this function is executed by the worker threads)
+ *
+ * Each block is an independent raw deflate stream that ends aligned to a byte boundary (sync flush),
+ * so the compressed blocks can be concatenated. The window is primed with the data of the previous
+ * block, which keeps the compression ratio close to the one of a single-threaded compression.
+ * @param job  Pointer to the `PngJob` structure describing the block
+ */
+static void deflateBlock(void *job) {
+    PngJob *block = (PngJob*)job; z_stream stream; long size; int result;
+    assert( block!=NULL && block->filtered!=NULL && block->buffer!=NULL );
+    
+    size = (long)block->numberOfLines * (block->lineSize+1);
+    block->adler     = adler32(adler32(0L,Z_NULL,0), block->filtered, (uInt)size);
+    block->hasFailed = TRUE;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY)!=Z_OK) { return; }
+    if (block->dictionarySize>0) {
+        deflateSetDictionary(&stream, block->dictionary, (uInt)block->dictionarySize);
+    }
+    stream.next_in   = block->filtered;
+    stream.avail_in  = (uInt)size;
+    stream.next_out  = &block->buffer[ZLIB_HEADER_SIZE];
+    stream.avail_out = (uInt)block->capacity;
+    result = deflate(&stream, block->isLast ? Z_FINISH : Z_SYNC_FLUSH);
+    block->outputSize = block->capacity - stream.avail_out;
+    block->hasFailed  = block->isLast ? (result!=Z_STREAM_END) : (result!=Z_OK || stream.avail_in!=0);
+    deflateEnd(&stream);
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > WRITTING TO SINK
+
+static void setInt32BE(Byte *ptr, unsigned long value) {
+    ptr[0] = (Byte)(value>>24);
+    ptr[1] = (Byte)(value>>16);
+    ptr[2] = (Byte)(value>> 8);
+    ptr[3] = (Byte)(value    );
+}
+
+/**
+ * Writes a PNG chunk (length + type + data + CRC)
+ * @param type      The four letters identifying the type of the chunk (ex: "IDAT")
+ * @param data      The data of the chunk
+ * @param dataSize  The size of `data` in number of bytes
+ * @param sink      The output sink where the chunk will be written
+ */
+static Bool writeChunk(const char *type, const Byte *data, long dataSize, ByteSink *sink) {
+    Byte header[8], footer[4]; unsigned long crc;
+    assert( type!=NULL && strlen(type)==4 );
+    assert( data!=NULL || dataSize==0 );
+    
+    setInt32BE(header, (unsigned long)dataSize);
+    memcpy(&header[4], type, 4);
+    crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, &header[4], 4);
+    if (dataSize>0) { crc = crc32(crc, data, (uInt)dataSize); }
+    setInt32BE(footer, crc);
+    return writeSinkBytes(sink, header, 8) &&
+           writeSinkBytes(sink, data, dataSize) &&
+           writeSinkBytes(sink, footer, 4);
+}
+
+/**
+ * Writes the PNG signature and the chunks that precede the image data (IHDR and PLTE)
+ */
+static Bool writeHeader(const ScanlineSource *source, int bitDepth, int numberOfColors, ByteSink *sink) {
+    static const Byte signature[8] = { 0x89, 'P','N','G', '\r','\n', 0x1A, '\n' };
+    Byte ihdr[13], plte[256*3]; const Byte *bgra; int i;
+    assert( 0<numberOfColors && numberOfColors<=256 );
+    
+    setInt32BE(&ihdr[0], (unsigned long)source->width );
+    setInt32BE(&ihdr[4], (unsigned long)source->height);
+    ihdr[8]  = (Byte)bitDepth;
+    ihdr[9]  = 3; /* color type = indexed colors */
+    ihdr[10] = 0; /* compression = deflate       */
+    ihdr[11] = 0; /* filter method = adaptive    */
+    ihdr[12] = 0; /* interlace = none            */
+    for (i=0; i<numberOfColors; ++i) {
+        bgra = &source->colorTable[i*4];
+        if (i*4+4 <= source->colorTableSize) { plte[i*3]=bgra[2]; plte[i*3+1]=bgra[1]; plte[i*3+2]=bgra[0]; }
+        else                                 { plte[i*3]=plte[i*3+1]=plte[i*3+2]=0; }
+    }
+    return writeSinkBytes(sink, signature, 8)  &&
+           writeChunk("IHDR", ihdr, 13, sink) &&
+           writeChunk("PLTE", plte, numberOfColors*3, sink);
+}
+
+/**
+ * Packs a scanline of the source with the bit depth used by the PNG image
+ * @param dest        The buffer where the packed scanline will be stored
+ * @param scanline    The scanline provided by the source
+ * @param width       The number of pixels in the scanline
+ * @param sourceBits  The number of bits of each pixel in `scanline` (1 or 8)
+ * @param bitDepth    The number of bits of each pixel in `dest` (1, 2, 4 or 8)
+ */
+static void packLine(Byte *dest, const Byte *scanline, int width, int sourceBits, int bitDepth) {
+    int x, i, byte; const int pixelsPerByte = 8/bitDepth, mask = (1<<bitDepth)-1;
+    
+    if (sourceBits==bitDepth) { memcpy(dest, scanline, ((long)width*bitDepth+7)/8); return; }
+    assert( sourceBits==8 );
+    for (x=0; x<width; x+=pixelsPerByte) {
+        for (byte=0, i=0; i<pixelsPerByte; ++i) {
+            byte = byte<<bitDepth | (x+i<width ? (scanline[x+i] & mask) : 0);
+        }
+        (*dest++) = (Byte)byte;
+    }
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > PUBLIC FUNCTIONS
+
+Bool writePngFromSource(ScanlineSource *source, int numberOfThreads, ByteSink *sink) {
+    int bitDepth, numberOfColors, lineSize, linesPerBlock, numberOfJobs, batchLines, numberOfBatchJobs;
+    int y, i, j, count; long blockSize, batchSize, tailSize=0, offset;
+    Byte *lines=NULL, *filtered=NULL, *prevLine=NULL, *tail=NULL; const Byte *scanline;
+    Byte *data; long dataSize; PngJob *jobs=NULL; unsigned long adler; Bool ok, isFirstBlock=TRUE;
+    assert( source!=NULL );
+    assert( source->width>0 && source->height>0 );
+    assert( source->bitsPerPixel==1 || source->bitsPerPixel==8 );
+    assert( source->colorTable!=NULL && source->colorTableSize>0 );
+    assert( sink!=NULL );
+    
+    /* the smallest bit depth able to represent every color used by the image */
+    numberOfColors = source->bitsPerPixel==1 ? 2 : min(source->numberOfColors, 256);
+    bitDepth       = numberOfColors<=2 ? 1 : numberOfColors<=4 ? 2 : numberOfColors<=16 ? 4 : 8;
+    lineSize       = (int)( ((long)source->width*bitDepth+7) / 8 );
+    
+    /* the image is processed in batches of one block per thread */
+    if (numberOfThreads<=0) { numberOfThreads = getNumberOfProcessors(); }
+    numberOfJobs  = numberOfThreads;
+    linesPerBlock = (int)( BLOCK_SIZE / (lineSize+1) );
+    if (linesPerBlock<1) { linesPerBlock=1; }
+    blockSize = (long)linesPerBlock * (lineSize+1);
+    
+    lines    = malloc((long)numberOfJobs * linesPerBlock * lineSize);
+    filtered = malloc((long)numberOfJobs * blockSize);
+    prevLine = malloc(lineSize);
+    tail     = malloc(DICTIONARY_SIZE);
+    jobs     = calloc(numberOfJobs, sizeof(PngJob));
+    ok       = lines && filtered && prevLine && tail && jobs;
+    for (j=0; ok && j<numberOfJobs; ++j) {
+        jobs[j].capacity = (long)compressBound((uLong)blockSize) + 64;
+        jobs[j].buffer   = malloc(ZLIB_HEADER_SIZE + jobs[j].capacity + ADLER_SIZE);
+        ok = jobs[j].buffer!=NULL;
+    }
+    
+    ok = ok && writeHeader(source, bitDepth, numberOfColors, sink);
+    adler = adler32(0L, Z_NULL, 0);
+    for (y=0; y<source->height && ok; y+=batchLines) {
+        
+        /* 1) read and pack the scanlines of the batch */
+        batchLines = min(numberOfJobs*linesPerBlock, source->height-y);
+        for (i=0; i<batchLines && ok; i+=count) {
+            scanline = readScanlines(source, y+i, &count);
+            if (!scanline) { ok=FALSE; break; }
+            count = min(count, batchLines-i);
+            for (j=0; j<count; ++j) {
+                packLine(&lines[(long)(i+j)*lineSize], &scanline[(long)j*source->scanlineSize],
+                         source->width, source->bitsPerPixel, bitDepth);
+            }
+        }
+        if (!ok) { break; }
+        
+        /* 2) filter and compress the blocks in parallel */
+        numberOfBatchJobs = (batchLines+linesPerBlock-1) / linesPerBlock;
+        for (j=0; j<numberOfBatchJobs; ++j) {
+            offset                  = (long)j * blockSize;
+            jobs[j].lines           = &lines[(long)j*linesPerBlock*lineSize];
+            jobs[j].prevLine        = j>0 ? &lines[((long)j*linesPerBlock-1)*lineSize] : (y>0 ? prevLine : NULL);
+            jobs[j].numberOfLines   = min(linesPerBlock, batchLines-j*linesPerBlock);
+            jobs[j].lineSize        = lineSize;
+            jobs[j].bitDepth        = bitDepth;
+            jobs[j].filtered        = &filtered[offset];
+            jobs[j].dictionary      = j>0 ? &filtered[offset-min(offset,DICTIONARY_SIZE)] : tail;
+            jobs[j].dictionarySize  = j>0 ? min(offset,DICTIONARY_SIZE) : tailSize;
+            jobs[j].isLast          = (y+batchLines==source->height && j==numberOfBatchJobs-1);
+        }
+        runJobs(filterBlock , jobs, sizeof(PngJob), numberOfBatchJobs, numberOfThreads);
+        runJobs(deflateBlock, jobs, sizeof(PngJob), numberOfBatchJobs, numberOfThreads);
+        
+        /* 3) write each block as an IDAT chunk, the first one starts with the zlib header
+         *    and the last one ends with the adler-32 checksum of all the filtered data */
+        for (j=0; j<numberOfBatchJobs && ok; ++j) {
+            if (jobs[j].hasFailed) { ok=FALSE; break; }
+            data     = &jobs[j].buffer[ZLIB_HEADER_SIZE];
+            dataSize = jobs[j].outputSize;
+            adler = adler32_combine(adler, jobs[j].adler, (z_off_t)jobs[j].numberOfLines*(lineSize+1));
+            if (isFirstBlock) { data-=ZLIB_HEADER_SIZE; dataSize+=ZLIB_HEADER_SIZE; data[0]=0x78; data[1]=0x9C; }
+            if (jobs[j].isLast) { setInt32BE(&data[dataSize], adler); dataSize+=ADLER_SIZE; }
+            ok = writeChunk("IDAT", data, dataSize, sink);
+            isFirstBlock = FALSE;
+        }
+        
+        /* 4) keep the data required by the first block of the next batch */
+        batchSize = (long)batchLines * (lineSize+1);
+        if (batchSize>=DICTIONARY_SIZE) {
+            memcpy(tail, &filtered[batchSize-DICTIONARY_SIZE], DICTIONARY_SIZE); tailSize = DICTIONARY_SIZE;
+        } else {
+            offset = min(tailSize, DICTIONARY_SIZE-batchSize);
+            memmove(tail, &tail[tailSize-offset], offset);
+            memcpy(&tail[offset], filtered, batchSize); tailSize = offset+batchSize;
+        }
+        memcpy(prevLine, &lines[(long)(batchLines-1)*lineSize], lineSize);
+    }
+    ok = ok && writeChunk("IEND", NULL, 0, sink);
+    
+    /* clean up and return */
+    for (j=0; jobs && j<numberOfJobs; ++j) { free(jobs[j].buffer); }
+    free(jobs); free(tail); free(prevLine); free(filtered); free(lines);
+    return ok;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file       png.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_png_h
+#define bas2img_png_h
+#include "globals.h"
+#include "scanline.h"
+#include "sink.h"
+
+
+/**
+ * Writes an image to a sink using the PNG format reading its pixels from a scanline source
+ *
+ * The image is stored with indexed colors using the smallest bit depth (1, 2, 4 or 8) able to
+ * represent `source->numberOfColors` colors. The filter of each scanline is chosen independently,
+ * and the filtered scanlines are split in blocks that are compressed in parallel, each block
+ * primed with the data of the previous one, so the result is a single zlib stream.
+ * @param source           The source providing the size, the palette and the scanlines of the image
+ * @param numberOfThreads  The number of threads used to compress the image (0 = one per processor)
+ * @param sink             The output sink where the image will be written
+ */
+Bool writePngFromSource(ScanlineSource *source, int numberOfThreads, ByteSink *sink);
+
+
+#endif /* bas2img_png_h */
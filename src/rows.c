@@ -69,18 +69,50 @@ static Rows reallocRows(Rows rowsToRealloc, int numberOfRows) {
     return rows;
 }
 
-static SingleRowPtr allocSingleRow(const Char256* chars, int numberOfChars, int wrapLength) {
+static SingleRowPtr allocSingleRow(const Char256* chars, const Attr *attrs, int numberOfChars, int wrapLength) {
     SingleRowPtr row; Bool isEndOfLine=TRUE;
-    assert( chars!=NULL && numberOfChars>=0 );
+    assert( chars!=NULL && attrs!=NULL && numberOfChars>=0 );
     
     if (wrapLength>0 && numberOfChars>wrapLength) { numberOfChars=wrapLength; isEndOfLine=FALSE; }
-    row = malloc( sizeof(SingleRow) + numberOfChars*sizeof(Char256) );
+    row = malloc( sizeof(SingleRow) + numberOfChars*(sizeof(Char256)+sizeof(Attr)) );
     row->length      = numberOfChars;
     row->isEndOfLine = isEndOfLine;
+    row->mark        = DIFF_NONE;
+    row->attrs       = (Attr*)&row->chars[numberOfChars];
     memcpy( row->chars, chars, numberOfChars );
+    memcpy( row->attrs, attrs, numberOfChars );
     return row;
 }
 
+/**
+ * Appends a text line to the array of rows (wrapping the line when necessary)
+ * @param inout_rows      Pointer to the array of rows, it can be reallocated to increase its capacity
+ * @param inout_rowIdx    Pointer to the index where the next row will be stored
+ * @param inout_capacity  Pointer to the maximum number of rows that the array can contain
+ * @param chars           The characters of the text line
+ * @param attrs           The attribute of each character of the text line
+ * @param numberOfChars   The number of characters in the text line
+ * @param wrapLength      The maximum length of each row (0 = never wrap)
+ * @param mark            The DiffMark assigned to each row of the text line
+ */
+static void appendLine(Rows *inout_rows, int *inout_rowIdx, int *inout_capacity,
+                       const Char256 *chars, const Attr *attrs, int numberOfChars, int wrapLength, Byte mark)
+{
+    Rows rows = (*inout_rows); int rowIdx = (*inout_rowIdx);
+    assert( rows!=NULL && chars!=NULL && attrs!=NULL );
+    do {
+        if (rowIdx==(*inout_capacity)) { (*inout_capacity)*=2; rows=reallocRows(rows,(*inout_capacity)); }
+        rows[rowIdx]   = allocSingleRow(chars, attrs, numberOfChars, wrapLength);
+        rows[rowIdx]->mark = mark;
+        chars         += rows[rowIdx]->length;
+        attrs         += rows[rowIdx]->length;
+        numberOfChars -= rows[rowIdx]->length;
+        ++rowIdx;
+    } while (numberOfChars>0);
+    (*inout_rows)   = rows;
+    (*inout_rowIdx) = rowIdx;
+}
+
 
 /*=================================================================================================================*/
 #pragma mark - > PUBLIC FUNCTIONS
@@ -93,38 +125,89 @@ Rows allocRowsFromBasicBuffer(const Byte *basicBuffer,
 {
     Rows rows;
     const Byte *sour, *sourEnd;
-    Byte *dest;
+    Byte *dest; Attr *attr;
     
-    Char256 lineBuffer[LINE_BUF_SIZE], *lineBufferPtr;
-    int column,rowIdx,numberOfChars; Bool newline;
+    Char256 lineBuffer[LINE_BUF_SIZE];
+    Attr    attrBuffer[LINE_BUF_SIZE];
+    int column,rowIdx,capacity,state; Bool newline;
     
     assert( basicBuffer!=NULL );
     assert( basicBufferSize>0 );
     assert( decodeFunc!=NULL );
     
-    rows    = allocRows(1024);
-    rowIdx  = 0;
+    capacity = 1024;
+    rows     = allocRows(capacity);
+    rowIdx   = 0;
     sour    = basicBuffer;
     sourEnd = (basicBuffer + basicBufferSize);
     while (sour<sourEnd) {
         dest    = lineBuffer;
+        attr    = attrBuffer;
+        state   = 0;
         /* decode a single line */
         newline=FALSE; while (!newline && sour<sourEnd) {
             column = (int)(dest-lineBuffer);
-            if ( column<MAX_COLUMN ) { newline = !(*decodeFunc)( &dest, &sour, (int)(sourEnd-sour) ); }
+            if ( column<MAX_COLUMN ) { newline = !(*decodeFunc)( &dest, &attr, &state, &sour, (int)(sourEnd-sour) ); }
             else                     { newline = TRUE; }
         }
+        assert( (dest-lineBuffer)==(attr-attrBuffer) );
         if (newline || dest>lineBuffer ) {
             /* copy the text line into the array of rows (wrapping the line when necessary) */
-            lineBufferPtr = lineBuffer;
-            numberOfChars = (int)(dest-lineBufferPtr);
-            do {
-                rows[rowIdx] = allocSingleRow(lineBufferPtr, numberOfChars, wrapLength);
-                lineBufferPtr += rows[rowIdx]->length;
-                numberOfChars -= rows[rowIdx]->length;
-                ++rowIdx;
-            } while (numberOfChars>0);
+            appendLine(&rows, &rowIdx, &capacity, lineBuffer, attrBuffer, (int)(dest-lineBuffer), wrapLength,
+                       DIFF_NONE);
+        }
+    }
+    return rows;
+}
+
+/**
+ * Allocates a new array of rows containing the same lines but wrapped to a different length
+ * @param rows        A previously allocated array of rows of text
+ * @param wrapLength  The maximum length of each row in the new array (0 = never wrap)
+ * @returns           The new array of rows, it must be deallocated with 'freeRows(..)'
+ */
+Rows allocWrappedRows(const Rows rows, int wrapLength) {
+    Rows wrappedRows; int i, rowIdx, capacity, numberOfChars;
+    Char256 lineBuffer[LINE_BUF_SIZE];
+    Attr    attrBuffer[LINE_BUF_SIZE];
+    assert( rows!=NULL );
+    
+    capacity    = 1024;
+    wrappedRows = allocRows(capacity);
+    rowIdx      = 0;
+    for (i=0; rows[i]; ++i) {
+        /* join all the rows that belong to the same line */
+        numberOfChars = rows[i]->length;
+        memcpy(lineBuffer, rows[i]->chars, numberOfChars);
+        memcpy(attrBuffer, rows[i]->attrs, numberOfChars);
+        while (!rows[i]->isEndOfLine && rows[i+1]!=NULL) {
+            ++i; assert( numberOfChars+rows[i]->length <= LINE_BUF_SIZE );
+            memcpy(&lineBuffer[numberOfChars], rows[i]->chars, rows[i]->length);
+            memcpy(&attrBuffer[numberOfChars], rows[i]->attrs, rows[i]->length);
+            numberOfChars += rows[i]->length;
         }
+        appendLine(&wrappedRows, &rowIdx, &capacity, lineBuffer, attrBuffer, numberOfChars, wrapLength,
+                   rows[i]->mark);
+    }
+    return wrappedRows;
+}
+
+/**
+ * Allocates a new array of rows containing a copy of each row in the provided list
+ * @param rowList       An array of pointers to the rows to copy (they can belong to different arrays of rows)
+ * @param marks         An array containing the DiffMark assigned to each copied row
+ * @param numberOfRows  The number of elements in `rowList` and `marks`
+ * @returns             The new array of rows, it must be deallocated with 'freeRows(..)'
+ */
+Rows allocMarkedRows(const SingleRowPtr *rowList, const Byte *marks, int numberOfRows) {
+    Rows rows; int i;
+    assert( rowList!=NULL && marks!=NULL && numberOfRows>=0 );
+    
+    rows = allocRows( numberOfRows>1 ? numberOfRows : 2 );
+    for (i=0; i<numberOfRows; ++i) {
+        rows[i] = allocSingleRow(rowList[i]->chars, rowList[i]->attrs, rowList[i]->length, 0);
+        rows[i]->isEndOfLine = rowList[i]->isEndOfLine;
+        rows[i]->mark        = marks[i];
     }
     return rows;
 }
@@ -163,6 +246,133 @@ int getNumberOfRows(const Rows rows) {
     return i;
 }
 
+/**
+ * Returns the number of rows that fit in a page starting at `firstRow` without splitting any line
+ *
+ * When a single line spans more rows than `maxRowsPerPage` it has to be split anyway,
+ * in that case the page is filled with as many rows as possible.
+ * @param rows            A previously allocated array of rows of text
+ * @param firstRow        The index of the first row of the page
+ * @param maxRowsPerPage  The maximum number of rows that fit in a page
+ * @returns               The number of rows of the page (zero when `firstRow` is past the last row)
+ */
+int getNumberOfRowsInPage(const Rows rows, int firstRow, int maxRowsPerPage) {
+    int i, numberOfRows=0;
+    assert( rows!=NULL );
+    assert( firstRow>=0 && maxRowsPerPage>0 );
+    
+    for (i=firstRow; rows[i] && (i-firstRow)<maxRowsPerPage; ++i) {
+        if (rows[i]->isEndOfLine || rows[i+1]==NULL) { numberOfRows=(i-firstRow)+1; }
+    }
+    return numberOfRows>0 ? numberOfRows : (i-firstRow);
+}
+
+/**
+ * Returns the wrap length that best fits the listing into the requested proportions
+ *
+ * The line lengths are collected in a single pass over the rows, then every possible
+ * wrap length is evaluated using only that histogram (no rows are allocated).
+ * When `maxColumns` or `maxRows` are provided the listing is fitted into that box,
+ * otherwise the proportions closest to `aspectRatio` are searched.
+ * @param rows         A previously allocated array of rows of text containing the lines to layout
+ * @param aspectRatio  The desired ratio between the number of columns and the number of rows (0 = ignore)
+ * @param maxColumns   The maximum number of columns of the listing (0 = no limit)
+ * @param maxRows      The maximum number of rows of the listing (0 = no limit)
+ * @returns            The best wrap length (never longer than the longest line)
+ */
+int getBestWrapLength(const Rows rows, double aspectRatio, int maxColumns, int maxRows) {
+    int histogram[LINE_BUF_SIZE+1];
+    int i, length, maxLength, wrapLength, bestWrapLength, numberOfRows;
+    double ratio, score, bestScore;
+    assert( rows!=NULL );
+    assert( aspectRatio>=0 && maxColumns>=0 && maxRows>=0 );
+    
+    /* build the histogram of line lengths */
+    memset(histogram, 0, sizeof(histogram));
+    maxLength=0; for (i=0; rows[i]; ++i) {
+        length=rows[i]->length;
+        while (!rows[i]->isEndOfLine && rows[i+1]!=NULL) { length+=rows[++i]->length; }
+        if (length>LINE_BUF_SIZE) { length=LINE_BUF_SIZE; }
+        if (length>maxLength    ) { maxLength=length;     }
+        ++histogram[length];
+    }
+    if (maxLength==0) { return 0; }
+    
+    /* only a limit in columns: the widest row that fits is the best */
+    if (maxColumns>0 && maxRows==0) { return maxColumns<maxLength ? maxColumns : maxLength; }
+    
+    /* evaluate each possible wrap length */
+    bestWrapLength=maxLength; bestScore=-1;
+    for (wrapLength=1; wrapLength<=maxLength; ++wrapLength) {
+        numberOfRows = histogram[0];
+        for (length=1; length<=maxLength; ++length) {
+            numberOfRows += histogram[length] * ((length+wrapLength-1)/wrapLength);
+        }
+        if (maxRows>0 && maxColumns>0) {
+            /* fit into the box: minimize the reduction needed to fit the listing */
+            score = (double)wrapLength/maxColumns;
+            ratio = (double)numberOfRows/maxRows;
+            if (ratio>score) { score=ratio; }
+        }
+        else if (maxRows>0) {
+            /* only a limit in rows: the narrowest listing that fits is the best */
+            score = numberOfRows<=maxRows ? wrapLength : maxLength+(double)numberOfRows/maxRows;
+        }
+        else {
+            /* match the aspect ratio */
+            ratio = (double)wrapLength/numberOfRows/(aspectRatio>0 ? aspectRatio : 1.0);
+            score = ratio>=1.0 ? ratio : 1.0/ratio;
+        }
+        if (bestScore<0 || score<bestScore) { bestScore=score; bestWrapLength=wrapLength; }
+    }
+    return bestWrapLength;
+}
+
+/**
+ * Returns the hash of the content of a row, including attributes and diff mark (FNV-1a)
+ */
+static unsigned long getRowContentHash(const SingleRow *row) {
+    unsigned long hash = 2166136261UL; int i;
+    assert( row!=NULL );
+    hash = ((hash ^ row->mark) * 16777619UL) & 0xFFFFFFFFUL;
+    for (i=0; i<row->length; ++i) {
+        hash = ((hash ^ row->chars[i]) * 16777619UL) & 0xFFFFFFFFUL;
+        hash = ((hash ^ row->attrs[i]) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+int * allocRepeatedRowIndexes(const Rows rows, int firstRow, int numberOfRows, int *out_repeated) {
+    unsigned long *hashes; int *indexes, *table; const SingleRow *row, *other;
+    int i, slot, tableMask, repeated=0;
+    assert( rows!=NULL && firstRow>=0 && numberOfRows>=0 && out_repeated!=NULL );
+    
+    /* open addressing hash table with at least twice as many slots as rows */
+    tableMask=1; while (tableMask<2*numberOfRows) { tableMask<<=1; } --tableMask;
+    indexes = malloc((numberOfRows>0 ? numberOfRows : 1) * sizeof(int));
+    hashes  = malloc((numberOfRows>0 ? numberOfRows : 1) * sizeof(unsigned long));
+    table   = malloc((tableMask+1) * sizeof(int));
+    if (!indexes || !hashes || !table) { free(indexes); free(hashes); free(table); return NULL; }
+    for (i=0; i<=tableMask; ++i) { table[i]=-1; }
+    
+    for (i=0; i<numberOfRows; ++i) {
+        row = rows[firstRow+i]; hashes[i] = getRowContentHash(row);
+        indexes[i] = i;
+        slot = (int)(hashes[i] & tableMask);
+        while (table[slot]>=0) {
+            other = rows[firstRow+table[slot]];
+            if (hashes[table[slot]]==hashes[i] && other->length==row->length && other->mark==row->mark &&
+                memcmp(other->chars, row->chars, row->length)==0 &&
+                memcmp(other->attrs, row->attrs, row->length*sizeof(Attr))==0) { indexes[i]=table[slot]; ++repeated; break; }
+            slot = (slot+1) & tableMask;
+        }
+        if (indexes[i]==i) { table[slot]=i; }
+    }
+    free(hashes); free(table);
+    (*out_repeated) = repeated;
+    return indexes;
+}
+
 /**
  * Returns the length of the longest line
  *
@@ -34,9 +34,19 @@
 #include "globals.h"
 
 
+/** The mark that a visual diff assigns to each row */
+typedef enum DiffMark {
+    DIFF_NONE = 0,  /* < the row is unchanged (or it is not part of a diff)    */
+    DIFF_ADDED,     /* < the row only exists in the new version of the program */
+    DIFF_REMOVED,   /* < the row only exists in the old version of the program */
+    DIFF_CHANGED    /* < the row replaces a different row of the old version   */
+} DiffMark;
+
 typedef struct SingleRow {
     int     length;
     Bool    isEndOfLine;
+    Byte    mark;      /* < the DiffMark of the row (DIFF_NONE when it is not part of a diff) */
+    Attr    *attrs;    /* < the attribute of each character (stored in the same block, after `chars`) */
     Char256 chars[1];
 } SingleRow;
 
@@ -52,6 +62,23 @@ Rows allocRowsFromBasicBuffer(const Byte *basicBuffer,
                               int         maximumRowLength,
                               DecodeFunc  decodeFunc);
 
+/**
+ * Allocates a new array of rows containing the same lines but wrapped to a different length
+ * @param rows        A previously allocated array of rows of text
+ * @param wrapLength  The maximum length of each row in the new array (0 = never wrap)
+ * @returns           The new array of rows, it must be deallocated with 'freeRows(..)'
+ */
+Rows allocWrappedRows(const Rows rows, int wrapLength);
+
+/**
+ * Allocates a new array of rows containing a copy of each row in the provided list
+ * @param rowList       An array of pointers to the rows to copy (they can belong to different arrays of rows)
+ * @param marks         An array containing the DiffMark assigned to each copied row
+ * @param numberOfRows  The number of elements in `rowList` and `marks`
+ * @returns             The new array of rows, it must be deallocated with 'freeRows(..)'
+ */
+Rows allocMarkedRows(const SingleRowPtr *rowList, const Byte *marks, int numberOfRows);
+
 void freeRows(Rows rows);
 
 /**
@@ -64,6 +91,49 @@ int getMaxRowLength(const Rows rows);
  */
 int getNumberOfRows(const Rows rows);
 
+/**
+ * Returns the number of rows that fit in a page starting at `firstRow` without splitting any line
+ *
+ * When a single line spans more rows than `maxRowsPerPage` it has to be split anyway,
+ * in that case the page is filled with as many rows as possible.
+ * @param rows            A previously allocated array of rows of text
+ * @param firstRow        The index of the first row of the page
+ * @param maxRowsPerPage  The maximum number of rows that fit in a page
+ * @returns               The number of rows of the page (zero when `firstRow` is past the last row)
+ */
+int getNumberOfRowsInPage(const Rows rows, int firstRow, int maxRowsPerPage);
+
+/**
+ * Returns the wrap length that best fits the listing into the requested proportions
+ *
+ * The line lengths are collected in a single pass over the rows, then every possible
+ * wrap length is evaluated using only that histogram (no rows are allocated).
+ * When `maxColumns` or `maxRows` are provided the listing is fitted into that box,
+ * otherwise the proportions closest to `aspectRatio` are searched.
+ * @param rows         A previously allocated array of rows of text containing the lines to layout
+ * @param aspectRatio  The desired ratio between the number of columns and the number of rows (0 = ignore)
+ * @param maxColumns   The maximum number of columns of the listing (0 = no limit)
+ * @param maxRows      The maximum number of rows of the listing (0 = no limit)
+ * @returns            The best wrap length (never longer than the longest line)
+ */
+int getBestWrapLength(const Rows rows, double aspectRatio, int maxColumns, int maxRows);
+
+/**
+ * Allocates an array that links each row of a range with the first identical row of the range
+ *
+ * Two rows are identical when they contain the same characters with the same attributes
+ * and the same diff mark, so they are drawn exactly the same way.
+ * @param rows          A previously allocated array of rows of text
+ * @param firstRow      The index of the first row of the range
+ * @param numberOfRows  The number of rows in the range
+ * @param out_repeated  Pointer to the variable where the number of repeated rows will be stored
+ * @returns
+ *     An array containing, for each row of the range, the index (relative to `firstRow`) of
+ *     the first identical row; it must be deallocated with 'free(..)'. NULL if there is not
+ *     enough memory.
+ */
+int * allocRepeatedRowIndexes(const Rows rows, int firstRow, int numberOfRows, int *out_repeated);
+
 /**
  * Returns the length of the longest line
  *
@@ -0,0 +1,92 @@
+/**
+ * @file       scanline.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include "scanline.h"
+
+
+/*=================================================================================================================*/
+#pragma mark - > MEMORY SOURCE
+
+static const Byte * readMemoryScanlines(ScanlineSource *source, int y, int *out_numberOfScanlines) {
+    assert( source!=NULL && source->pixelData!=NULL && out_numberOfScanlines!=NULL );
+    
+    /* upside-down images can only provide one scanline at a time */
+    if (source->scanlineSize<0) {
+        (*out_numberOfScanlines) = 1;
+        return &source->pixelData[ (long)(-source->scanlineSize) * (source->height-y-1) ];
+    }
+    (*out_numberOfScanlines) = source->height - y;
+    return &source->pixelData[ (long)source->scanlineSize * y ];
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > PUBLIC FUNCTIONS
+
+void initMemoryScanlineSource(ScanlineSource *source,
+                              int             width,
+                              int             height,
+                              int             scanlineSize,
+                              int             bitsPerPixel,
+                              const void     *colorTable,
+                              int             colorTableSize,
+                              const void     *pixelData)
+{
+    assert( source!=NULL );
+    assert( width>0 && height>0 && scanlineSize!=0 );
+    assert( bitsPerPixel==1 || bitsPerPixel==8 );
+    assert( colorTable!=NULL && colorTableSize>0 );
+    assert( pixelData!=NULL );
+    
+    source->width          = width;
+    source->height         = height;
+    source->bitsPerPixel   = bitsPerPixel;
+    source->scanlineSize   = scanlineSize;
+    source->colorTable     = (const Byte*)colorTable;
+    source->colorTableSize = colorTableSize;
+    source->numberOfColors = 1<<bitsPerPixel;
+    source->readScanlines  = readMemoryScanlines;
+    source->context        = NULL;
+    source->pixelData      = (const Byte*)pixelData;
+}
+
+const Byte * readScanlines(ScanlineSource *source, int y, int *out_numberOfScanlines) {
+    const Byte *scanlines;
+    assert( source!=NULL && source->readScanlines!=NULL );
+    assert( 0<=y && y<source->height );
+    assert( out_numberOfScanlines!=NULL );
+    
+    scanlines = source->readScanlines(source, y, out_numberOfScanlines);
+    assert( !scanlines || (*out_numberOfScanlines>0 && y+(*out_numberOfScanlines)<=source->height) );
+    return scanlines;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file       scanline.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_scanline_h
+#define bas2img_scanline_h
+#include "globals.h"
+
+
+/**
+ * A source of pixels that the image encoders read scanline by scanline (from top to bottom)
+ *
+ * The encoders never need the whole image in memory: they pull the scanlines on demand and
+ * the source can produce them in bands (for example, rendering a few rows of text at a time)
+ * reusing the same buffer once the encoder has moved past them.
+ */
+typedef struct ScanlineSource {
+    int          width;          /* < the width of the image in pixels                        */
+    int          height;         /* < the height of the image in pixels                       */
+    int          bitsPerPixel;   /* < the number of bits for each pixel (1 or 8)               */
+    int          scanlineSize;   /* < the number of bytes from one scanline to the next        */
+    const Byte  *colorTable;     /* < an array of BGRA elements that maps pixel values to colors */
+    int          colorTableSize; /* < the size of `colorTable` in number of BYTES              */
+    int          numberOfColors; /* < the pixels only use the first `numberOfColors` colors of the table */
+    const Byte* (*readScanlines)(struct ScanlineSource *source, int y, int *out_numberOfScanlines);
+    void        *context;        /* < the private data used by `readScanlines`                 */
+    const Byte  *pixelData;      /* < the pixels of a source created with 'initMemoryScanlineSource(..)' */
+} ScanlineSource;
+
+
+/**
+ * Initializes a source that reads the scanlines from an image stored in memory
+ * @param source          The source to initialize
+ * @param width           The width of the image in pixels
+ * @param height          The height of the image in pixels
+ * @param scanlineSize    The number of bytes from one line of pixels to the next (negative = upside-down image)
+ * @param bitsPerPixel    The number of bits for each pixel (valid values: 1 or 8)
+ * @param colorTable      An array of RGBA elements (32bits) that maps the values in the pixel-data to rgb colors
+ * @param colorTableSize  The size of `colorTable` in number of BYTES
+ * @param pixelData       An array of values describing each pixel of the image
+ */
+void initMemoryScanlineSource(ScanlineSource *source,
+                              int             width,
+                              int             height,
+                              int             scanlineSize,
+                              int             bitsPerPixel,
+                              const void     *colorTable,
+                              int             colorTableSize,
+                              const void     *pixelData);
+
+/**
+ * Returns a pointer to the scanline `y` and the number of consecutive scanlines available after it
+ * @param source                 The source of the scanlines
+ * @param y                      The index of the first scanline requested (0 = top of the image)
+ * @param out_numberOfScanlines  Pointer to the variable where the number of available scanlines will be stored
+ * @returns                      The pixels of the scanline `y` or NULL if the source failed to produce them
+ */
+const Byte * readScanlines(ScanlineSource *source, int y, int *out_numberOfScanlines);
+
+
+#endif /* bas2img_scanline_h */
@@ -0,0 +1,240 @@
+/**
+ * @file       sink.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sink.h"
+#define SINK_BUFFER_SIZE   (256L*1024) /* < size of the buffer used by the fd and FILE sinks       */
+#define MEMORY_SINK_SIZE   (64L*1024)  /* < initial size of the buffer used by the memory sinks   */
+
+
+/*=================================================================================================================*/
+#pragma mark - > TARGETS
+
+/**
+ * Writes a block of bytes to a file descriptor retrying the partial and interrupted writes
+ */
+static Bool writeToFd(int fd, const Byte *data, long dataSize) {
+    long written;
+    while (dataSize>0) {
+        written = (long)write(fd, data, (size_t)dataSize);
+        if (written<0 && errno==EINTR) { continue; }
+        if (written<=0) { return FALSE; }
+        data += written; dataSize -= written;
+    }
+    return TRUE;
+}
+
+static Bool writeToFile(FILE *file, const Byte *data, long dataSize) {
+    return dataSize==(long)fwrite(data, 1, (size_t)dataSize, file);
+}
+
+/**
+ * Delivers the buffered bytes and the provided data to the target of a fd or FILE sink
+ *
+ * Big blocks are written directly to the target, small ones are buffered.
+ */
+static Bool drainToTarget(ByteSink *sink, const Byte *data, long dataSize) {
+    Bool ok = TRUE;
+    if (sink->size>0) {
+        ok = sink->file ? writeToFile(sink->file, sink->buffer, sink->size)
+                        : writeToFd  (sink->fd  , sink->buffer, sink->size);
+        sink->size = 0;
+    }
+    if (ok && dataSize>=sink->capacity) {
+        ok = sink->file ? writeToFile(sink->file, data, dataSize)
+                        : writeToFd  (sink->fd  , data, dataSize);
+    }
+    else if (ok && dataSize>0) {
+        memcpy(sink->buffer, data, dataSize);
+        sink->size = dataSize;
+    }
+    return ok;
+}
+
+/**
+ * Grows the buffer of a memory sink to make room for the provided data
+ */
+static Bool drainToMemory(ByteSink *sink, const Byte *data, long dataSize) {
+    long capacity = sink->capacity; Byte *buffer;
+    if (sink->size+dataSize > capacity) {
+        while (sink->size+dataSize > capacity) { capacity *= 2; }
+        buffer = realloc(sink->buffer, capacity);
+        if (!buffer) { return FALSE; }
+        sink->buffer   = buffer;
+        sink->capacity = capacity;
+    }
+    if (dataSize>0) {
+        memcpy(&sink->buffer[sink->size], data, dataSize);
+        sink->size += dataSize;
+    }
+    return TRUE;
+}
+
+static Bool initSink(ByteSink *sink, long capacity) {
+    assert( sink!=NULL && capacity>0 );
+    sink->buffer    = malloc(capacity);
+    sink->size      = 0;
+    sink->capacity  = capacity;
+    sink->hasFailed = FALSE;
+    sink->drain     = drainToTarget;
+    sink->fd        = -1;
+    sink->ownsFd    = FALSE;
+    sink->file      = NULL;
+    sink->mapped    = NULL;
+    sink->mappedSize= 0;
+    return sink->buffer!=NULL;
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > INITIALIZATION
+
+Bool initMemorySink(ByteSink *sink) {
+    if (!initSink(sink, MEMORY_SINK_SIZE)) { return FALSE; }
+    sink->drain = drainToMemory;
+    return TRUE;
+}
+
+Bool initFdSink(ByteSink *sink, int fd) {
+    assert( fd>=0 );
+    if (!initSink(sink, SINK_BUFFER_SIZE)) { return FALSE; }
+    sink->fd = fd;
+    return TRUE;
+}
+
+Bool initFileSink(ByteSink *sink, FILE *file) {
+    assert( file!=NULL );
+    if (!initSink(sink, SINK_BUFFER_SIZE)) { return FALSE; }
+    sink->file = file;
+    return TRUE;
+}
+
+Bool openFileSink(ByteSink *sink, const utf8 *filePath) {
+    int fd;
+    assert( sink!=NULL && filePath!=NULL );
+    
+    /* the file is opened for reading too because 'mapSink(..)' needs it, if that is not allowed it is only written */
+    fd = open(filePath, O_RDWR|O_CREAT|O_TRUNC, 0666);
+    if (fd<0) { fd = open(filePath, O_WRONLY|O_CREAT|O_TRUNC, 0666); }
+    if (fd<0) { return FALSE; }
+    if (!initFdSink(sink, fd)) { close(fd); return FALSE; }
+    sink->ownsFd = TRUE;
+    return TRUE;
+}
+
+Bool closeSink(ByteSink *sink) {
+    assert( sink!=NULL );
+    flushSink(sink);
+    if (sink->file && fflush(sink->file)!=0) { sink->hasFailed = TRUE; }
+    if (sink->mapped && munmap(sink->mapped, sink->mappedSize)!=0) { sink->hasFailed = TRUE; }
+    sink->mapped = NULL;
+    if (sink->ownsFd && close(sink->fd)!=0 ) { sink->hasFailed = TRUE; }
+    if (sink->drain!=drainToMemory) {
+        free(sink->buffer);
+        sink->buffer   = NULL;
+        sink->capacity = 0;
+    }
+    sink->ownsFd = FALSE;
+    return !sink->hasFailed;
+}
+
+Bool removeSinkFile(const utf8 *filePath) {
+    struct stat info;
+    assert( filePath!=NULL );
+    if (stat(filePath, &info)!=0 || !S_ISREG(info.st_mode)) { return TRUE; }
+    return unlink(filePath)==0;
+}
+
+Byte * mapSink(ByteSink *sink, size_t size) {
+    struct stat info; void *data; int error;
+    assert( sink!=NULL && sink->mapped==NULL && size>0 );
+    
+    /* only a regular file where nothing has been written yet */
+    if (sink->drain!=drainToTarget || sink->fd<0 || sink->size>0 || sink->hasFailed) { return NULL; }
+    if (fstat(sink->fd, &info)!=0 || !S_ISREG(info.st_mode) || lseek(sink->fd,0,SEEK_CUR)!=0) { return NULL; }
+    
+    /* the blocks are reserved instead of truncating the file, */
+    /* so a full disk is detected here and not as a SIGBUS while drawing */
+    do { error = posix_fallocate(sink->fd, 0, (off_t)size); } while (error==EINTR);
+    if (error!=0) { if (ftruncate(sink->fd,0)!=0) { sink->hasFailed=TRUE; } return NULL; }
+    data = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, sink->fd, 0);
+    if (data==MAP_FAILED) { if (ftruncate(sink->fd,0)!=0) { sink->hasFailed=TRUE; } return NULL; }
+    sink->mapped     = (Byte*)data;
+    sink->mappedSize = size;
+    return sink->mapped;
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > WRITTING
+
+Bool writeSinkBytes(ByteSink *sink, const void *data, long dataSize) {
+    assert( sink!=NULL && sink->buffer!=NULL );
+    assert( data!=NULL || dataSize==0 );
+    assert( dataSize>=0 );
+    
+    if (sink->hasFailed) { return FALSE; }
+    if (dataSize==0    ) { return TRUE;  } /* `data` can be NULL, memcpy(..) does not accept it */
+    if (sink->size+dataSize <= sink->capacity) {
+        memcpy(&sink->buffer[sink->size], data, dataSize);
+        sink->size += dataSize;
+        return TRUE;
+    }
+    if (!sink->drain(sink, (const Byte*)data, dataSize)) { sink->hasFailed = TRUE; }
+    return !sink->hasFailed;
+}
+
+Bool writeSinkByte(ByteSink *sink, unsigned value) {
+    Byte byte;
+    assert( sink!=NULL && sink->buffer!=NULL );
+    
+    if (sink->size<sink->capacity && !sink->hasFailed) {
+        sink->buffer[sink->size++] = (Byte)value;
+        return TRUE;
+    }
+    byte = (Byte)value;
+    return writeSinkBytes(sink, &byte, 1);
+}
+
+Bool flushSink(ByteSink *sink) {
+    assert( sink!=NULL );
+    if (sink->hasFailed) { return FALSE; }
+    if (sink->drain==drainToMemory || sink->size==0) { return TRUE; }
+    if (!sink->drain(sink, NULL, 0)) { sink->hasFailed = TRUE; }
+    return !sink->hasFailed;
+}
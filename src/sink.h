@@ -0,0 +1,155 @@
+/**
+ * @file       sink.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_sink_h
+#define bas2img_sink_h
+#include <stdio.h>
+#include "globals.h"
+
+
+/**
+ * A destination for the bytes produced by the image writers
+ *
+ * The bytes are accumulated in a large buffer and delivered to the target in big blocks,
+ * so the writers can emit many small fields without paying a system call for each one.
+ * There are three kinds of sinks:
+ *   - memory : the buffer grows to contain the complete output (no file is involved)
+ *   - fd     : the buffer is delivered to a file descriptor with 'write(..)'
+ *   - FILE   : the buffer is delivered to a standard C stream with 'fwrite(..)'
+ * Once a write fails the sink ignores all following writes and 'closeSink(..)' reports the error.
+ */
+typedef struct ByteSink {
+    Byte  *buffer;    /* < the bytes not yet delivered to the target (all the bytes in a memory sink) */
+    long   size;      /* < the number of bytes stored in `buffer`                                  */
+    long   capacity;  /* < the number of bytes that fit in `buffer`                                 */
+    Bool   hasFailed; /* < TRUE = a write has failed and the sink ignores any other write           */
+    Bool (*drain)(struct ByteSink *sink, const Byte *data, long dataSize);
+    int    fd;        /* < the target file descriptor (fd sinks)                                   */
+    Bool   ownsFd;    /* < TRUE = the file descriptor is closed by 'closeSink(..)'                 */
+    FILE  *file;      /* < the target stream (FILE sinks)                                          */
+    Byte  *mapped;    /* < the target file mapped in memory by 'mapSink(..)' (NULL = not mapped)    */
+    size_t mappedSize; /* < the number of bytes of `mapped`                                         */
+} ByteSink;
+
+
+/*=================================================================================================================*/
+#pragma mark - > INITIALIZATION
+
+/**
+ * Initializes a sink that stores all the bytes in a growable memory buffer
+ *
+ * After 'closeSink(..)' the output is available in `sink->buffer` (`sink->size` bytes)
+ * and the buffer must be deallocated with 'free(..)'.
+ * @param sink  The sink to initialize
+ * @returns     FALSE if there is not enough memory
+ */
+Bool initMemorySink(ByteSink *sink);
+
+/**
+ * Initializes a sink that writes to an already open file descriptor (the descriptor is not closed)
+ * @param sink  The sink to initialize
+ * @param fd    The file descriptor where the bytes will be written
+ * @returns     FALSE if there is not enough memory
+ */
+Bool initFdSink(ByteSink *sink, int fd);
+
+/**
+ * Initializes a sink that writes to a standard C stream (the stream is not closed)
+ * @param sink  The sink to initialize
+ * @param file  The stream where the bytes will be written
+ * @returns     FALSE if there is not enough memory
+ */
+Bool initFileSink(ByteSink *sink, FILE *file);
+
+/**
+ * Creates (or truncates) a file and initializes a sink that writes to it
+ * @param sink      The sink to initialize
+ * @param filePath  The path to the file to create, it is closed by 'closeSink(..)'
+ * @returns         FALSE if the file cannot be created or there is not enough memory
+ */
+Bool openFileSink(ByteSink *sink, const utf8 *filePath);
+
+/**
+ * Maps in memory the target file of a sink where nothing has been written yet
+ *
+ * The file gets its final size (with all its blocks reserved) and any byte stored in the
+ * mapping goes directly to the file, the mapping is released by 'closeSink(..)'.
+ * Once mapped, nothing must be written to the sink.
+ * @param sink  The sink to map, only the sinks writing to a regular file can be mapped
+ * @param size  The final size of the file in bytes
+ * @returns     The zero-filled bytes of the file or NULL if the target cannot be mapped
+ *              (the sink can still be used normally)
+ */
+Byte * mapSink(ByteSink *sink, size_t size);
+
+/**
+ * Delivers any buffered byte to the target and releases the resources used by the sink
+ * (the buffer of a memory sink is kept, it contains the output)
+ * @param sink  The sink to close
+ * @returns     FALSE if any write to the sink has failed
+ */
+Bool closeSink(ByteSink *sink);
+
+/**
+ * Removes the file written by a sink opened with 'openFileSink(..)' when its content could not be generated
+ * (only regular files are removed, a device or a pipe used as target is left untouched)
+ * @param filePath  The path to the file to remove
+ * @returns         FALSE if the file is a regular file that cannot be removed
+ */
+Bool removeSinkFile(const utf8 *filePath);
+
+
+/*=================================================================================================================*/
+#pragma mark - > WRITTING
+
+/**
+ * Writes a block of bytes to the sink
+ * @param sink      The sink where the bytes will be written
+ * @param data      The bytes to write
+ * @param dataSize  The number of bytes to write
+ */
+Bool writeSinkBytes(ByteSink *sink, const void *data, long dataSize);
+
+/**
+ * Writes a single byte to the sink
+ * @param sink   The sink where the byte will be written
+ * @param value  The value of the byte (only the lowest 8 bits are written)
+ */
+Bool writeSinkByte(ByteSink *sink, unsigned value);
+
+/**
+ * Delivers any buffered byte to the target (memory sinks keep all their bytes)
+ * @param sink  The sink to flush
+ */
+Bool flushSink(ByteSink *sink);
+
+
+#endif /* bas2img_sink_h */
@@ -0,0 +1,181 @@
+/**
+ * @file       sixel.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sixel.h"
+#define BAND_HEIGHT  6     /* < number of scanlines encoded by each sixel               */
+#define SIXEL_BASE   63    /* < the character of the sixel without pixels ('?')         */
+#define MIN_REPEAT   4     /* < the shortest run written with a repeat introducer ("!n") */
+#define MAX_COLORS   256
+
+typedef struct SixelBand {
+    Byte *planes;                   /* < the sixels of each color, `width` bytes for each color       */
+    long  counts[MAX_COLORS];       /* < the number of pixels of each color in the band                */
+    int   usedColors[MAX_COLORS];   /* < the colors that appear in the band (in order of appearance)  */
+    int   numberOfUsedColors;       /* < the number of elements in `usedColors`                       */
+    int   width;                    /* < the width of the image in pixels                             */
+} SixelBand;
+
+
+/*=================================================================================================================*/
+#pragma mark - > FORMATTING
+
+static char * putInt(char *dest, long value) {
+    char digits[24]; int count=0;
+    do { digits[count++] = (char)('0' + value%10); value/=10; } while (value>0);
+    while (count>0) { *dest++ = digits[--count]; }
+    return dest;
+}
+
+static char * putRun(char *dest, long count, int sixel) {
+    if (count>=MIN_REPEAT) { *dest++ = '!'; dest = putInt(dest,count); *dest++ = (char)sixel; }
+    else { while (count-->0) { *dest++ = (char)sixel; } }
+    return dest;
+}
+
+static Bool writeText(ByteSink *sink, const char *begin, const char *end) {
+    return writeSinkBytes(sink, begin, (long)(end-begin));
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > ENCODING
+
+/**
+ * Adds a scanline to the color planes of the band
+ * @param band          The band where the scanline is added
+ * @param line          The pixels of the scanline
+ * @param bitsPerPixel  The number of bits for each pixel (1 or 8)
+ * @param bit           The bit of the sixels that corresponds to the scanline
+ */
+static void addScanline(SixelBand *band, const Byte *line, int bitsPerPixel, int bit) {
+    int x, color;
+    for (x=0; x<band->width; ++x) {
+        color = bitsPerPixel==1 ? (line[x>>3]>>(7-(x&7))) & 1 : line[x];
+        if (band->counts[color]==0) { band->usedColors[band->numberOfUsedColors++] = color; }
+        ++band->counts[color];
+        band->planes[(long)color*band->width+x] |= (Byte)bit;
+    }
+}
+
+/**
+ * Encodes the sixels of a color plane, the empty sixels at the end of the plane are not written
+ * @param dest   The buffer where the encoded plane will be stored
+ * @param plane  The sixels of the color, one for each column of the image
+ * @param width  The number of sixels in the plane
+ * @returns      A pointer to the end of the encoded plane
+ */
+static char * encodePlane(char *dest, const Byte *plane, int width) {
+    int x, end, value;
+    while (width>0 && plane[width-1]==0) { --width; }
+    x=0; while (x<width) {
+        value = plane[x];
+        for (end=x+1; end<width && plane[end]==value; ++end) { }
+        dest = putRun(dest, end-x, SIXEL_BASE+value);
+        x = end;
+    }
+    return dest;
+}
+
+/**
+ * Writes the color registers of the palette (the components are percentages in the sixel format)
+ * @param sink    The output sink where the palette will be written
+ * @param source  The source providing the palette of the image
+ */
+static Bool writePalette(ByteSink *sink, const ScanlineSource *source) {
+    char text[64], *ptr; const Byte *bgra; int i; Bool ok=TRUE;
+    for (i=0; i<source->numberOfColors && i*4<source->colorTableSize && ok; ++i) {
+        bgra = &source->colorTable[i*4];
+        ptr = text; *ptr++ = '#'; ptr = putInt(ptr,i); *ptr++ = ';'; *ptr++ = '2';
+        *ptr++ = ';'; ptr = putInt(ptr, (bgra[2]*100+127)/255);
+        *ptr++ = ';'; ptr = putInt(ptr, (bgra[1]*100+127)/255);
+        *ptr++ = ';'; ptr = putInt(ptr, (bgra[0]*100+127)/255);
+        ok = writeText(sink, text, ptr);
+    }
+    return ok;
+}
+
+Bool writeSixelFromSource(ScanlineSource *source, ByteSink *sink) {
+    SixelBand band; const Byte *line; char *text=NULL, *ptr;
+    int y, j, i, color, background, numberOfLines, numberOfScanlines, numberOfColors; Bool ok=TRUE;
+    assert( source!=NULL && sink!=NULL );
+    assert( source->bitsPerPixel==1 || source->bitsPerPixel==8 );
+    
+    numberOfColors = source->bitsPerPixel==1 ? 2 : MAX_COLORS;
+    band.width  = source->width;
+    band.planes = calloc((size_t)numberOfColors*band.width, 1);
+    text        = malloc((size_t)band.width + 64);
+    if (!band.planes || !text) { free(band.planes); free(text); return FALSE; }
+    band.numberOfUsedColors = 0;
+    for (i=0; i<MAX_COLORS; ++i) { band.counts[i]=0; }
+    
+    /* DCS introducer (pixels not drawn keep the background) and raster attributes with square pixels */
+    ptr = text; *ptr++ = 0x1B; *ptr++ = 'P'; *ptr++ = '0'; *ptr++ = ';'; *ptr++ = '1'; *ptr++ = 'q';
+    *ptr++ = '"'; *ptr++ = '1'; *ptr++ = ';'; *ptr++ = '1';
+    *ptr++ = ';'; ptr = putInt(ptr, source->width);
+    *ptr++ = ';'; ptr = putInt(ptr, source->height);
+    ok = writeText(sink, text, ptr) && writePalette(sink, source);
+    
+    for (y=0; y<source->height && ok; y+=BAND_HEIGHT) {
+        /* the scanlines are read one by one, a streamed source may reuse its buffer after each call */
+        numberOfLines = source->height-y<BAND_HEIGHT ? source->height-y : BAND_HEIGHT;
+        for (j=0; j<numberOfLines && ok; ++j) {
+            line = readScanlines(source, y+j, &numberOfScanlines);
+            if (line) { addScanline(&band, line, source->bitsPerPixel, 1<<j); } else { ok=FALSE; }
+        }
+        if (!ok) { break; }
+        /* the most used color fills the whole band, the other colors are drawn over it */
+        background = band.usedColors[0];
+        for (i=1; i<band.numberOfUsedColors; ++i) {
+            if (band.counts[band.usedColors[i]]>band.counts[background]) { background=band.usedColors[i]; }
+        }
+        ptr = text; *ptr++ = '#'; ptr = putInt(ptr,background);
+        ptr = putRun(ptr, band.width, SIXEL_BASE + (1<<numberOfLines) - 1);
+        ok = ok && writeText(sink, text, ptr);
+        for (i=0; i<band.numberOfUsedColors; ++i) { color=band.usedColors[i];
+            if (color!=background && ok) {
+                ptr = text; *ptr++ = '$'; *ptr++ = '#'; ptr = putInt(ptr,color);
+                ptr = encodePlane(ptr, &band.planes[(long)color*band.width], band.width);
+                ok = writeText(sink, text, ptr);
+            }
+            memset(&band.planes[(long)color*band.width], 0, band.width);
+            band.counts[color] = 0;
+        }
+        band.numberOfUsedColors = 0;
+        if (y+BAND_HEIGHT<source->height) { ok = ok && writeSinkByte(sink,'-'); }
+    }
+    ok = ok && writeSinkByte(sink,0x1B) && writeSinkByte(sink,'\\');
+    free(band.planes);
+    free(text);
+    return ok;
+}
@@ -0,0 +1,283 @@
+/**
+ * @file       svg.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "svg.h"
+#define CHARHEIGHT  8     /* < number of bytes of each character in the font data                    */
+#define TEXT_SIZE   2048  /* < the size of the buffer where each element is formatted (a full symbol) */
+#define isSameColor(color1,color2) ((color1).r==(color2).r && (color1).g==(color2).g && (color1).b==(color2).b)
+
+
+/*=================================================================================================================*/
+#pragma mark - > FORMATTING
+
+static char * putString(char *dest, const char *string) {
+    while (*string!='\0') { *dest++ = *string++; }
+    return dest;
+}
+
+static char * putInt(char *dest, long value) {
+    char digits[24]; int count=0;
+    if (value<0) { *dest++ = '-'; value = -value; }
+    do { digits[count++] = (char)('0' + value%10); value/=10; } while (value>0);
+    while (count>0) { *dest++ = digits[--count]; }
+    return dest;
+}
+
+static char * putHexByte(char *dest, unsigned value) {
+    static const char hexDigits[] = "0123456789abcdef";
+    *dest++ = hexDigits[(value>>4) & 0x0F];
+    *dest++ = hexDigits[ value     & 0x0F];
+    return dest;
+}
+
+static char * putColor(char *dest, Rgb color) {
+    *dest++ = '#';
+    dest = putHexByte(dest, color.r);
+    dest = putHexByte(dest, color.g);
+    dest = putHexByte(dest, color.b);
+    return dest;
+}
+
+static Bool writeText(ByteSink *sink, const char *begin, const char *end) {
+    return writeSinkBytes(sink, begin, (long)(end-begin));
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > GLYPHS
+
+static Byte getGlyphLine(const SvgStyle *style, int charCode, int y) {
+    return (Byte)(style->font->data[charCode*CHARHEIGHT+y] & (0xFF00>>style->fontWidth) & 0xFF);
+}
+
+static Bool isBlankGlyph(const SvgStyle *style, int charCode) {
+    int y;
+    for (y=0; y<style->fontHeight; ++y) { if (getGlyphLine(style,charCode,y)!=0) { return FALSE; } }
+    return TRUE;
+}
+
+/**
+ * Writes the symbol of a glyph as a single path made of rectangles
+ *
+ * Each horizontal run of pixels is extended downward while the next lines contain the same run,
+ * so vertical strokes are a single rectangle instead of one per line.
+ * @param sink      The output sink where the symbol will be written
+ * @param style     The style containing the font and the size of the characters
+ * @param charCode  The code of the character to write
+ */
+static Bool writeGlyphSymbol(ByteSink *sink, const SvgStyle *style, int charCode) {
+    Byte lines[CHARHEIGHT], consumed[CHARHEIGHT]; unsigned available, run;
+    int x, y, end, height;
+    char text[TEXT_SIZE], *ptr;
+    assert( style->fontWidth<=8 && style->fontHeight<=CHARHEIGHT );
+    
+    for (y=0; y<style->fontHeight; ++y) { lines[y]=getGlyphLine(style,charCode,y); consumed[y]=0; }
+    ptr = putString(text, "<symbol id=\"g"); ptr = putHexByte(ptr, charCode);
+    ptr = putString(ptr , "\" overflow=\"visible\"><path d=\"");
+    for (y=0; y<style->fontHeight; ++y) {
+        available = lines[y] & ~consumed[y];
+        x=0; while (x<style->fontWidth) {
+            if ( (available & (0x80>>x))==0 ) { ++x; continue; }
+            for (end=x; end<style->fontWidth && (available & (0x80>>end))!=0; ++end) { }
+            run = (0xFFu>>x) & ~(0xFFu>>end);
+            for (height=1; y+height<style->fontHeight && (lines[y+height] & ~consumed[y+height] & run)==run; ++height) {
+                consumed[y+height] |= run;
+            }
+            ptr = putString(ptr,"M"); ptr = putInt(ptr,x); ptr = putString(ptr," "); ptr = putInt(ptr,y);
+            ptr = putString(ptr,"h"); ptr = putInt(ptr,end-x);
+            ptr = putString(ptr,"v"); ptr = putInt(ptr,height);
+            ptr = putString(ptr,"h-"); ptr = putInt(ptr,end-x); ptr = putString(ptr,"z");
+            x = end;
+        }
+    }
+    ptr = putString(ptr, "\"/></symbol>\n");
+    assert( ptr-text < TEXT_SIZE );
+    return writeText(sink, text, ptr);
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > ROWS
+
+static Bool hasVisibleGlyphs(const SingleRow *row, const Bool *isBlank) {
+    int column;
+    for (column=0; column<row->length; ++column) { if (!isBlank[row->chars[column]]) { return TRUE; } }
+    return FALSE;
+}
+
+/**
+ * Writes a reference to the glyph symbol of each visible character of a row
+ *
+ * The characters are placed inside a group that already has the plain text color,
+ * only the consecutive characters with a different color are wrapped in a group of their own.
+ * @param sink     The output sink where the characters will be written
+ * @param row      The row of text to write
+ * @param style    The style containing the size and the colors of the characters
+ * @param isBlank  An array indicating for each character code whether its glyph has no pixels
+ */
+static Bool writeRowGlyphs(ByteSink *sink, const SingleRow *row, const SvgStyle *style, const Bool *isBlank) {
+    const Rgb plain = style->textColors[ATTR_PLAIN];
+    Rgb current = plain, color; int column, charCode; Bool ok=TRUE;
+    char text[TEXT_SIZE], *ptr;
+    
+    for (column=0; column<row->length && ok; ++column) {
+        charCode = row->chars[column]; if (isBlank[charCode]) { continue; }
+        color = style->textColors[row->attrs[column]];
+        ptr = text;
+        if (!isSameColor(color,current)) {
+            if (!isSameColor(current,plain)) { ptr = putString(ptr,"</g>"); }
+            if (!isSameColor(color  ,plain)) {
+                ptr = putString(ptr,"<g fill=\""); ptr = putColor(ptr,color); ptr = putString(ptr,"\">");
+            }
+            current = color;
+        }
+        ptr = putString(ptr,"<use xlink:href=\"#g"); ptr = putHexByte(ptr,charCode);
+        ptr = putString(ptr,"\" x=\""); ptr = putInt(ptr,(long)column*style->fontWidth); ptr = putString(ptr,"\"/>");
+        ok = writeText(sink, text, ptr);
+    }
+    if (!isSameColor(current,plain)) { ok = ok && writeSinkBytes(sink,"</g>",4); }
+    return ok;
+}
+
+/**
+ * Writes the background of the listing, the consecutive rows with the same diff mark share a rectangle
+ * @param sink             The output sink where the background will be written
+ * @param rows             The array of rows containing the source code
+ * @param firstRow         The index of the first row of the image
+ * @param numberOfRows     The number of rows of the image
+ * @param numberOfColumns  The number of characters that fit in each row of the image
+ * @param style            The style containing the size and the colors of the image
+ */
+static Bool writeBackground(ByteSink       *sink,
+                            const Rows     rows,
+                            int            firstRow,
+                            int            numberOfRows,
+                            int            numberOfColumns,
+                            const SvgStyle *style) {
+    int i, first, mark; Bool ok=TRUE;
+    char text[TEXT_SIZE], *ptr;
+    
+    ptr = putString(text, "<rect width=\""); ptr = putInt(ptr,(long)numberOfColumns*style->fontWidth);
+    ptr = putString(ptr , "\" height=\"");   ptr = putInt(ptr,(long)numberOfRows*style->fontHeight);
+    ptr = putString(ptr , "\" fill=\"");     ptr = putColor(ptr,style->background);
+    ptr = putString(ptr , "\"/>\n");
+    ok = writeText(sink, text, ptr);
+    
+    i=0; while (i<numberOfRows && style->markColors && ok) {
+        first=i; mark=rows[firstRow+i]->mark;
+        while (i<numberOfRows && rows[firstRow+i]->mark==mark) { ++i; }
+        if (mark==DIFF_NONE) { continue; }
+        ptr = putString(text, "<rect y=\""); ptr = putInt(ptr,(long)first*style->fontHeight);
+        ptr = putString(ptr , "\" width=\""); ptr = putInt(ptr,(long)numberOfColumns*style->fontWidth);
+        ptr = putString(ptr , "\" height=\""); ptr = putInt(ptr,(long)(i-first)*style->fontHeight);
+        ptr = putString(ptr , "\" fill=\""); ptr = putColor(ptr,style->markColors[mark]);
+        ptr = putString(ptr , "\"/>\n");
+        ok = writeText(sink, text, ptr);
+    }
+    return ok;
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > SVG
+
+Bool writeSvgFromRows(ByteSink       *sink,
+                      const Rows     rows,
+                      int            firstRow,
+                      int            numberOfRows,
+                      int            numberOfColumns,
+                      const SvgStyle *style) {
+    Bool isUsed[256], isBlank[256]; Byte *isReferenced=NULL;
+    int *repeated=NULL, numberOfRepeated=0, i, column, viewWidth, viewHeight;
+    const SingleRow *row; Bool ok;
+    char text[TEXT_SIZE], *ptr;
+    assert( sink!=NULL && rows!=NULL && style!=NULL && style->font!=NULL && style->textColors!=NULL );
+    assert( firstRow>=0 && numberOfRows>0 && numberOfColumns>0 );
+    
+    /* the glyphs used in the listing (a symbol is only defined for the glyphs with pixels) */
+    for (i=0; i<256; ++i) { isUsed[i]=FALSE; isBlank[i]=isBlankGlyph(style,i); }
+    for (i=0; i<numberOfRows; ++i) { row=rows[firstRow+i];
+        for (column=0; column<row->length; ++column) { isUsed[row->chars[column]]=TRUE; }
+    }
+    /* the repeated rows reference the first identical row (without memory all rows are written) */
+    repeated = allocRepeatedRowIndexes(rows, firstRow, numberOfRows, &numberOfRepeated);
+    if (repeated && numberOfRepeated>0) { isReferenced = calloc(numberOfRows, sizeof(Byte)); }
+    if (isReferenced) { for (i=0; i<numberOfRows; ++i) { isReferenced[repeated[i]] |= (repeated[i]!=i); } }
+    else              { free(repeated); repeated=NULL; }
+    
+    /* the view box measures the listing in font pixels, the image size scales it */
+    viewWidth  = numberOfColumns * style->fontWidth;
+    viewHeight = numberOfRows    * style->fontHeight;
+    if (style->orientation==VERTICAL) { i=viewWidth; viewWidth=viewHeight; viewHeight=i; }
+    ptr = putString(text, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    ptr = putString(ptr , "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\"");
+    ptr = putString(ptr , " version=\"1.1\" width=\""); ptr = putInt(ptr,style->width);
+    ptr = putString(ptr , "\" height=\""); ptr = putInt(ptr,style->height);
+    ptr = putString(ptr , "\" viewBox=\"0 0 "); ptr = putInt(ptr,viewWidth);
+    ptr = putString(ptr , " "); ptr = putInt(ptr,viewHeight);
+    ptr = putString(ptr , "\" preserveAspectRatio=\"none\" shape-rendering=\"crispEdges\">\n<defs>\n");
+    ok  = writeText(sink, text, ptr);
+    for (i=0; i<256 && ok; ++i) { if (isUsed[i] && !isBlank[i]) { ok = writeGlyphSymbol(sink,style,i); } }
+    
+    /* vertical: the listing is rotated 90 degrees clockwise, the first row is the rightmost column */
+    ptr = putString(text, "</defs>\n<g");
+    if (style->orientation==VERTICAL) {
+        ptr = putString(ptr, " transform=\"translate("); ptr = putInt(ptr,viewWidth); ptr = putString(ptr,",0) rotate(90)\"");
+    }
+    ptr = putString(ptr, ">\n");
+    ok = ok && writeText(sink, text, ptr);
+    ok = ok && writeBackground(sink, rows, firstRow, numberOfRows, numberOfColumns, style);
+    
+    ptr = putString(text, "<g fill=\""); ptr = putColor(ptr,style->textColors[ATTR_PLAIN]); ptr = putString(ptr,"\">\n");
+    ok  = ok && writeText(sink, text, ptr);
+    for (i=0; i<numberOfRows && ok; ++i) { row=rows[firstRow+i];
+        if (!hasVisibleGlyphs(row,isBlank)) { continue; }
+        if (repeated && repeated[i]!=i) {
+            ptr = putString(text, "<use xlink:href=\"#r"); ptr = putInt(ptr,repeated[i]);
+            ptr = putString(ptr , "\" y=\""); ptr = putInt(ptr,(long)(i-repeated[i])*style->fontHeight);
+            ptr = putString(ptr , "\"/>\n");
+            ok = writeText(sink, text, ptr);
+            continue;
+        }
+        ptr = putString(text, "<g");
+        if (isReferenced && isReferenced[i]) { ptr = putString(ptr," id=\"r"); ptr = putInt(ptr,i); ptr = putString(ptr,"\""); }
+        ptr = putString(ptr, " transform=\"translate(0,"); ptr = putInt(ptr,(long)i*style->fontHeight);
+        ptr = putString(ptr, ")\">");
+        ok = writeText(sink, text, ptr) && writeRowGlyphs(sink, row, style, isBlank) && writeSinkBytes(sink,"</g>\n",5);
+    }
+    ok = ok && writeSinkBytes(sink, "</g>\n</g>\n</svg>\n", 17);
+    free(isReferenced);
+    free(repeated);
+    return ok;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file       svg.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_svg_h
+#define bas2img_svg_h
+#include "globals.h"
+#include "rows.h"
+#include "sink.h"
+
+/** The appearance of the listing stored in a SVG image */
+typedef struct SvgStyle {
+    const Font *font;              /* < the font used to draw the characters                          */
+    int         fontWidth;         /* < the width of each character in font pixels                    */
+    int         fontHeight;        /* < the height of each character in font pixels                   */
+    int         width;             /* < the width of the image in pixels (the font pixels are scaled)  */
+    int         height;            /* < the height of the image in pixels                             */
+    Orientation orientation;       /* < VERTICAL = the listing is rotated 90 degrees clockwise        */
+    Rgb         background;        /* < the background color of the rows that are not marked          */
+    const Rgb  *markColors;        /* < the background color of each DiffMark (NULL = no mark is drawn) */
+    const Rgb  *textColors;        /* < the text color of each syntax category (Attr)                 */
+} SvgStyle;
+
+
+/**
+ * Writes the listing contained in a range of rows to a sink using the SVG format
+ *
+ * Each glyph used in the listing is defined only once as a `<symbol>` made of the rectangles
+ * of its bitmap, and each character is a reference to the symbol of its glyph, so the size of
+ * the file depends on the number of characters but not on the size of the image.
+ * @param sink             The output sink where the image will be written
+ * @param rows             The array of rows containing the source code
+ * @param firstRow         The index of the first row to include in the image
+ * @param numberOfRows     The number of rows to include in the image
+ * @param numberOfColumns  The number of characters that fit in each row of the image
+ * @param style            The font, size and colors of the image
+ */
+Bool writeSvgFromRows(ByteSink       *sink,
+                      const Rows     rows,
+                      int            firstRow,
+                      int            numberOfRows,
+                      int            numberOfColumns,
+                      const SvgStyle *style);
+
+
+#endif /* bas2img_svg_h */
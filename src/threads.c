@@ -0,0 +1,141 @@
+/**
+ * @file       threads.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include "threads.h"
+#if !defined(DISABLE_THREADS)
+#   include <pthread.h>
+#   include <unistd.h>
+#endif
+#define MAX_NUMBER_OF_THREADS 64
+
+typedef struct JobQueue {
+    JobFunc jobFunc;
+    Byte    *jobs;
+    int     jobSize;
+    int     numberOfJobs;
+    int     nextJob;
+#if !defined(DISABLE_THREADS)
+    pthread_mutex_t mutex;
+#endif
+} JobQueue;
+
+
+/*=================================================================================================================*/
+#pragma mark - > WORKER THREADS
+
+/**
+ * Removes the next job from the queue
+ * @param queue  The queue of pending jobs
+ * @returns      A pointer to the job data or NULL if the queue is empty
+ */
+static void * popJob(JobQueue *queue) {
+    int jobIndex;
+#if !defined(DISABLE_THREADS)
+    pthread_mutex_lock(&queue->mutex);
+#endif
+    jobIndex = queue->nextJob<queue->numberOfJobs ? queue->nextJob++ : -1;
+#if !defined(DISABLE_THREADS)
+    pthread_mutex_unlock(&queue->mutex);
+#endif
+    return jobIndex>=0 ? &queue->jobs[jobIndex*queue->jobSize] : NULL;
+}
+
+/**
+ * Main loop of each worker, it processes jobs until the queue is empty
+ * @param queue  The queue of pending jobs (as a void pointer to match the pthread prototype)
+ */
+static void * workerLoop(void *queue) {
+    void *job;
+    while ( (job=popJob((JobQueue*)queue))!=NULL ) { (*((JobQueue*)queue)->jobFunc)(job); }
+    return NULL;
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > PUBLIC FUNCTIONS
+
+/**
+ * Returns the number of processors currently available (always 1 or greater)
+ */
+int getNumberOfProcessors(void) {
+    long numberOfProcessors = 1;
+#if !defined(DISABLE_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+    numberOfProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return numberOfProcessors>1 ? (int)numberOfProcessors : 1;
+}
+
+/**
+ * Processes a list of jobs distributing them among a pool of worker threads
+ *
+ * The function does not return until all jobs have been processed. Each job
+ * is processed exactly once, but the order and the thread used are undefined.
+ * @param jobFunc          The function that processes a single job
+ * @param jobs             An array containing the data of each job
+ * @param jobSize          The size of each element of `jobs` in number of bytes
+ * @param numberOfJobs     The number of elements in `jobs`
+ * @param numberOfThreads  The maximum number of threads to use (0 = one per processor)
+ */
+Bool runJobs(JobFunc jobFunc, void *jobs, int jobSize, int numberOfJobs, int numberOfThreads) {
+    JobQueue queue;
+#if !defined(DISABLE_THREADS)
+    pthread_t threads[MAX_NUMBER_OF_THREADS]; int i, numberOfStartedThreads=0;
+#endif
+    assert( jobFunc!=NULL );
+    assert( jobs!=NULL || numberOfJobs==0 );
+    assert( jobSize>0 && numberOfJobs>=0 );
+    
+    if (numberOfThreads<=0              ) { numberOfThreads = getNumberOfProcessors(); }
+    if (numberOfThreads>numberOfJobs    ) { numberOfThreads = numberOfJobs;            }
+    if (numberOfThreads>MAX_NUMBER_OF_THREADS) { numberOfThreads = MAX_NUMBER_OF_THREADS; }
+    
+    queue.jobFunc      = jobFunc;
+    queue.jobs         = (Byte*)jobs;
+    queue.jobSize      = jobSize;
+    queue.numberOfJobs = numberOfJobs;
+    queue.nextJob      = 0;
+    
+#if !defined(DISABLE_THREADS)
+    pthread_mutex_init(&queue.mutex, NULL);
+    /* the calling thread is also a worker, so only N-1 extra threads are started */
+    for (i=1; i<numberOfThreads; ++i) {
+        if ( pthread_create(&threads[numberOfStartedThreads],NULL,workerLoop,&queue)==0 ) { ++numberOfStartedThreads; }
+    }
+    workerLoop(&queue);
+    for (i=0; i<numberOfStartedThreads; ++i) { pthread_join(threads[i],NULL); }
+    pthread_mutex_destroy(&queue.mutex);
+#else
+    workerLoop(&queue);
+#endif
+    return TRUE;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file       threads.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_threads_h
+#define bas2img_threads_h
+#include "globals.h"
+
+
+/**
+ * Prototype of function used to process a single job
+ * @param job  Pointer to the data of the job to process
+ */
+typedef void (*JobFunc)(void *job);
+
+/**
+ * Returns the number of processors currently available (always 1 or greater)
+ */
+int getNumberOfProcessors(void);
+
+/**
+ * Processes a list of jobs distributing them among a pool of worker threads
+ *
+ * The function does not return until all jobs have been processed. Each job
+ * is processed exactly once, but the order and the thread used are undefined.
+ * @param jobFunc          The function that processes a single job
+ * @param jobs             An array containing the data of each job
+ * @param jobSize          The size of each element of `jobs` in number of bytes
+ * @param numberOfJobs     The number of elements in `jobs`
+ * @param numberOfThreads  The maximum number of threads to use (0 = one per processor)
+ */
+Bool runJobs(JobFunc jobFunc, void *jobs, int jobSize, int numberOfJobs, int numberOfThreads);
+
+
+#endif /* bas2img_threads_h */
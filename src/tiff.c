@@ -0,0 +1,398 @@
+/**
+ * @file       tiff.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tiff.h"
+#include "threads.h"
+#define STRIP_SIZE       (64L*1024)  /* < approximate amount of packed pixels encoded in each strip          */
+#define NUMBER_OF_TAGS   13          /* < number of entries in the image file directory                     */
+#define HEADER_SIZE      8           /* < size of the TIFF header ("II", 42 and the offset of the directory) */
+#define DIRECTORY_SIZE   (2 + NUMBER_OF_TAGS*12 + 4)
+#define RESOLUTION       72          /* < pixels per inch stored in the XResolution and YResolution tags    */
+#define SHORT            3           /* < tag type: 16-bit unsigned integer  */
+#define LONG             4           /* < tag type: 32-bit unsigned integer  */
+#define RATIONAL         5           /* < tag type: two LONGs (numerator / denominator) */
+#define min(a,b)         ((a)<(b) ? (a) : (b))
+#define absolute(x)      ((x)<0 ? -(x) : (x))
+#define getPixel(line,x) ((line)[(x)>>3]>>(7-((x)&7)) & 1)
+
+/** A code of the CCITT T.4/T.6 standards, stored in the lowest `length` bits of `code` */
+typedef struct FaxCode {
+    unsigned short code;
+    unsigned short length;
+} FaxCode;
+
+typedef struct BitWriter {
+    ByteSink     *sink;   /* < the sink where the complete bytes are written           */
+    unsigned long bits;   /* < the bits not yet written (only the lowest `count` bits)  */
+    int           count;  /* < the number of bits in `bits`, always less than 8 between codes */
+} BitWriter;
+
+typedef struct TiffJob {
+    const Byte *lines;          /* < the packed 1-bpp scanlines of the strip                      */
+    const Byte *blankLine;      /* < a line of white pixels, the reference for the first scanline  */
+    int         lineSize;       /* < the number of bytes of each packed scanline                  */
+    int         numberOfLines;  /* < the number of scanlines in the strip                         */
+    int         width;          /* < the number of pixels of each scanline                        */
+    ByteSink    output;         /* < memory sink where the encoded strip is stored                */
+    Bool        hasFailed;      /* < TRUE = the encoding of the strip failed                      */
+} TiffJob;
+
+
+/*=================================================================================================================*/
+#pragma mark - > CODE TABLES
+
+static const FaxCode theWhiteTerminatingCodes[64] = {
+    {0x0035, 8}, {0x0007, 6}, {0x0007, 4}, {0x0008, 4}, {0x000B, 4}, {0x000C, 4}, {0x000E, 4}, {0x000F, 4},
+    {0x0013, 5}, {0x0014, 5}, {0x0007, 5}, {0x0008, 5}, {0x0008, 6}, {0x0003, 6}, {0x0034, 6}, {0x0035, 6},
+    {0x002A, 6}, {0x002B, 6}, {0x0027, 7}, {0x000C, 7}, {0x0008, 7}, {0x0017, 7}, {0x0003, 7}, {0x0004, 7},
+    {0x0028, 7}, {0x002B, 7}, {0x0013, 7}, {0x0024, 7}, {0x0018, 7}, {0x0002, 8}, {0x0003, 8}, {0x001A, 8},
+    {0x001B, 8}, {0x0012, 8}, {0x0013, 8}, {0x0014, 8}, {0x0015, 8}, {0x0016, 8}, {0x0017, 8}, {0x0028, 8},
+    {0x0029, 8}, {0x002A, 8}, {0x002B, 8}, {0x002C, 8}, {0x002D, 8}, {0x0004, 8}, {0x0005, 8}, {0x000A, 8},
+    {0x000B, 8}, {0x0052, 8}, {0x0053, 8}, {0x0054, 8}, {0x0055, 8}, {0x0024, 8}, {0x0025, 8}, {0x0058, 8},
+    {0x0059, 8}, {0x005A, 8}, {0x005B, 8}, {0x004A, 8}, {0x004B, 8}, {0x0032, 8}, {0x0033, 8}, {0x0034, 8}
+};
+
+static const FaxCode theWhiteMakeupCodes[27] = {
+    {0x001B, 5}, {0x0012, 5}, {0x0017, 6}, {0x0037, 7}, {0x0036, 8}, {0x0037, 8}, {0x0064, 8}, {0x0065, 8},
+    {0x0068, 8}, {0x0067, 8}, {0x00CC, 9}, {0x00CD, 9}, {0x00D2, 9}, {0x00D3, 9}, {0x00D4, 9}, {0x00D5, 9},
+    {0x00D6, 9}, {0x00D7, 9}, {0x00D8, 9}, {0x00D9, 9}, {0x00DA, 9}, {0x00DB, 9}, {0x0098, 9}, {0x0099, 9},
+    {0x009A, 9}, {0x0018, 6}, {0x009B, 9}
+};
+
+static const FaxCode theBlackTerminatingCodes[64] = {
+    {0x0037,10}, {0x0002, 3}, {0x0003, 2}, {0x0002, 2}, {0x0003, 3}, {0x0003, 4}, {0x0002, 4}, {0x0003, 5},
+    {0x0005, 6}, {0x0004, 6}, {0x0004, 7}, {0x0005, 7}, {0x0007, 7}, {0x0004, 8}, {0x0007, 8}, {0x0018, 9},
+    {0x0017,10}, {0x0018,10}, {0x0008,10}, {0x0067,11}, {0x0068,11}, {0x006C,11}, {0x0037,11}, {0x0028,11},
+    {0x0017,11}, {0x0018,11}, {0x00CA,12}, {0x00CB,12}, {0x00CC,12}, {0x00CD,12}, {0x0068,12}, {0x0069,12},
+    {0x006A,12}, {0x006B,12}, {0x00D2,12}, {0x00D3,12}, {0x00D4,12}, {0x00D5,12}, {0x00D6,12}, {0x00D7,12},
+    {0x006C,12}, {0x006D,12}, {0x00DA,12}, {0x00DB,12}, {0x0054,12}, {0x0055,12}, {0x0056,12}, {0x0057,12},
+    {0x0064,12}, {0x0065,12}, {0x0052,12}, {0x0053,12}, {0x0024,12}, {0x0037,12}, {0x0038,12}, {0x0027,12},
+    {0x0028,12}, {0x0058,12}, {0x0059,12}, {0x002B,12}, {0x002C,12}, {0x005A,12}, {0x0066,12}, {0x0067,12}
+};
+
+static const FaxCode theBlackMakeupCodes[27] = {
+    {0x000F,10}, {0x00C8,12}, {0x00C9,12}, {0x005B,12}, {0x0033,12}, {0x0034,12}, {0x0035,12}, {0x006C,13},
+    {0x006D,13}, {0x004A,13}, {0x004B,13}, {0x004C,13}, {0x004D,13}, {0x0072,13}, {0x0073,13}, {0x0074,13},
+    {0x0075,13}, {0x0076,13}, {0x0077,13}, {0x0052,13}, {0x0053,13}, {0x0054,13}, {0x0055,13}, {0x005A,13},
+    {0x005B,13}, {0x0064,13}, {0x0065,13}
+};
+
+static const FaxCode theExtendedMakeupCodes[13] = {
+    {0x0008,11}, {0x000C,11}, {0x000D,11}, {0x0012,12}, {0x0013,12}, {0x0014,12}, {0x0015,12}, {0x0016,12},
+    {0x0017,12}, {0x001C,12}, {0x001D,12}, {0x001E,12}, {0x001F,12}
+};
+
+/* the codes of the two-dimensional coding modes */
+static const FaxCode thePassCode       = { 0x1, 4 };
+static const FaxCode theHorizontalCode = { 0x1, 3 };
+static const FaxCode theEolCode        = { 0x1,12 };
+/* the vertical mode codes indexed by a1-b1+3 (VL3, VL2, VL1, V0, VR1, VR2, VR3) */
+static const FaxCode theVerticalCodes[7] = {
+    { 0x2, 7 }, { 0x2, 6 }, { 0x2, 3 }, { 0x1, 1 }, { 0x3, 3 }, { 0x3, 6 }, { 0x3, 7 }
+};
+
+
+/*=================================================================================================================*/
+#pragma mark - > CCITT GROUP 4 ENCODER
+
+static void putCode(BitWriter *writer, FaxCode code) {
+    writer->bits   = (writer->bits << code.length) | code.code;
+    writer->count += code.length;
+    while (writer->count>=8) {
+        writer->count -= 8;
+        writeSinkByte(writer->sink, (unsigned)(writer->bits >> writer->count));
+    }
+    writer->bits &= (1UL << writer->count) - 1;
+}
+
+/** Writes the pending bits padding the last byte with zeros */
+static void flushBits(BitWriter *writer) {
+    if (writer->count>0) { writeSinkByte(writer->sink, (unsigned)(writer->bits << (8-writer->count))); }
+    writer->bits  = 0;
+    writer->count = 0;
+}
+
+/**
+ * Writes the codes of a run of pixels of the same color (makeup codes followed by a terminating code)
+ * @param writer  The writer where the codes will be stored
+ * @param length  The number of pixels in the run
+ * @param color   The color of the pixels (0 = white, 1 = black)
+ */
+static void putRunLength(BitWriter *writer, int length, int color) {
+    const FaxCode *terminating = color ? theBlackTerminatingCodes : theWhiteTerminatingCodes;
+    const FaxCode *makeup      = color ? theBlackMakeupCodes      : theWhiteMakeupCodes;
+    int m;
+    while (length>=2560+64) { putCode(writer, theExtendedMakeupCodes[12]); length-=2560; }
+    if (length>=64) {
+        m = length/64;
+        putCode(writer, m<=27 ? makeup[m-1] : theExtendedMakeupCodes[m-28]);
+        length -= m*64;
+    }
+    putCode(writer, terminating[length]);
+}
+
+/**
+ * Returns the position of the first pixel with a specific color at or after a position
+ *
+ * The bytes without any pixel of that color are skipped at once.
+ * @param line   The packed 1-bpp scanline
+ * @param x      The position where the search starts
+ * @param width  The number of pixels of the scanline
+ * @param color  The color to find (0 or 1)
+ * @returns      The position of the pixel or `width` if there is none
+ */
+static int findPixel(const Byte *line, int x, int width, int color) {
+    const Byte skip = color ? 0x00 : 0xFF;
+    while (x<width && (x&7)!=0) { if (getPixel(line,x)==color) { return x; } ++x; }
+    while (x<width && line[x>>3]==skip) { x+=8; }
+    while (x<width && getPixel(line,x)!=color) { ++x; }
+    return x<width ? x : width;
+}
+
+/**
+ * Encodes a scanline with the two-dimensional coding of T.6
+ *
+ * `a0` is the reference element of the coding line (-1 = the imaginary white pixel before
+ * the line), `a1`/`a2` its next changing elements, `b1`/`b2` the changing elements of the
+ * reference line; the coding mode is chosen from their positions as the standard describes.
+ * @param writer  The writer where the codes will be stored
+ * @param line    The packed 1-bpp scanline to encode
+ * @param ref     The packed 1-bpp scanline above `line` (all white for the first one)
+ * @param width   The number of pixels of each scanline
+ */
+static void encodeLine(BitWriter *writer, const Byte *line, const Byte *ref, int width) {
+    int a0=-1, a1, a2, b1, b2, color=0;
+    while (a0<width) {
+        a1 = findPixel(line, a0+1, width, !color);
+        /* b1: the first element of the reference line after a0 that changes to the opposite color */
+        b1 = a0+1;
+        if (b1>0 && getPixel(ref,b1-1)!=color) { b1 = findPixel(ref, b1, width, color); }
+        b1 = findPixel(ref, b1, width, !color);
+        b2 = findPixel(ref, b1, width,  color);
+        if (b2<a1) {
+            putCode(writer, thePassCode);
+            a0 = b2;
+        }
+        else if (absolute(a1-b1)<=3) {
+            putCode(writer, theVerticalCodes[a1-b1+3]);
+            a0    = a1;
+            color = !color;
+        }
+        else {
+            a2 = findPixel(line, a1, width, color);
+            putCode(writer, theHorizontalCode);
+            putRunLength(writer, a1-(a0<0 ? 0 : a0), color);
+            putRunLength(writer, a2-a1, !color);
+            a0 = a2;
+        }
+    }
+}
+
+/**
+ * Encodes the scanlines of a strip (this function is executed by the worker threads)
+ * @param job  Pointer to the `TiffJob` structure describing the strip
+ */
+static void encodeStrip(void *job) {
+    TiffJob *strip = (TiffJob*)job; BitWriter writer; const Byte *line, *ref; int i;
+    assert( strip!=NULL && strip->lines!=NULL && strip->blankLine!=NULL );
+    
+    writer.sink  = &strip->output;
+    writer.bits  = 0;
+    writer.count = 0;
+    ref = strip->blankLine;
+    for (i=0; i<strip->numberOfLines; ++i) {
+        line = &strip->lines[(long)i*strip->lineSize];
+        encodeLine(&writer, line, ref, strip->width);
+        ref = line;
+    }
+    /* end of facsimile block */
+    putCode(&writer, theEolCode);
+    putCode(&writer, theEolCode);
+    flushBits(&writer);
+    strip->hasFailed = strip->output.hasFailed;
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > WRITTING TO SINK
+
+static int writeInt16(unsigned value, ByteSink *sink) {
+    Byte data[2];
+    data[0] = (Byte)(value   );
+    data[1] = (Byte)(value>>8);
+    return writeSinkBytes(sink, data, 2);
+}
+
+static int writeInt32(unsigned long value, ByteSink *sink) {
+    Byte data[4];
+    data[0] = (Byte)(value    );
+    data[1] = (Byte)(value>> 8);
+    data[2] = (Byte)(value>>16);
+    data[3] = (Byte)(value>>24);
+    return writeSinkBytes(sink, data, 4);
+}
+
+/** Writes an entry of the image file directory (values of up to 4 bytes are stored in the entry itself) */
+static int writeTag(unsigned tag, unsigned type, unsigned long count, unsigned long value, ByteSink *sink) {
+    return
+    writeInt16(tag  , sink) &&
+    writeInt16(type , sink) &&
+    writeInt32(count, sink) &&
+    writeInt32(value, sink);
+}
+
+/**
+ * Writes the header, the image file directory and the arrays it points to
+ *
+ * The layout is: header, directory, strip offsets, strip byte counts, resolution, strips.
+ * @param source          The source of the image
+ * @param rowsPerStrip    The number of scanlines of each strip
+ * @param stripSizes      The size in bytes of each encoded strip
+ * @param numberOfStrips  The number of elements in `stripSizes`
+ * @param sink            The output sink where the data will be written
+ */
+static Bool writeDirectory(const ScanlineSource *source, int rowsPerStrip,
+                           const long *stripSizes, int numberOfStrips, ByteSink *sink) {
+    const int arraySize = numberOfStrips>1 ? 4*numberOfStrips : 0;
+    const unsigned long offsetsOffset    = HEADER_SIZE + DIRECTORY_SIZE;
+    const unsigned long countsOffset     = offsetsOffset + arraySize;
+    const unsigned long resolutionOffset = countsOffset  + arraySize;
+    const unsigned long dataOffset       = resolutionOffset + 8;
+    unsigned long offset; int i; Bool ok;
+    
+    ok =
+    writeSinkBytes(sink, "II", 2) && writeInt16(42, sink) && writeInt32(HEADER_SIZE, sink) &&
+    writeInt16(NUMBER_OF_TAGS, sink)                                          &&
+    writeTag(256, LONG    , 1, source->width , sink) /* ImageWidth        */ &&
+    writeTag(257, LONG    , 1, source->height, sink) /* ImageLength       */ &&
+    writeTag(258, SHORT   , 1, 1             , sink) /* BitsPerSample     */ &&
+    writeTag(259, SHORT   , 1, 4             , sink) /* Compression: T.6  */ &&
+    writeTag(262, SHORT   , 1, 0             , sink) /* WhiteIsZero       */ &&
+    writeTag(273, LONG    , numberOfStrips, numberOfStrips>1 ? offsetsOffset : dataOffset, sink) /* StripOffsets */ &&
+    writeTag(277, SHORT   , 1, 1             , sink) /* SamplesPerPixel   */ &&
+    writeTag(278, LONG    , 1, rowsPerStrip  , sink) /* RowsPerStrip      */ &&
+    writeTag(279, LONG    , numberOfStrips, numberOfStrips>1 ? countsOffset : (unsigned long)stripSizes[0], sink) &&
+    writeTag(282, RATIONAL, 1, resolutionOffset, sink) /* XResolution     */ &&
+    writeTag(283, RATIONAL, 1, resolutionOffset, sink) /* YResolution     */ &&
+    writeTag(293, LONG    , 1, 0             , sink) /* T6Options         */ &&
+    writeTag(296, SHORT   , 1, 2             , sink) /* ResolutionUnit: inch */ &&
+    writeInt32(0, sink); /* no more directories */
+    
+    for (i=0, offset=dataOffset; i<numberOfStrips && arraySize>0 && ok; ++i) {
+        ok = writeInt32(offset, sink); offset += stripSizes[i];
+    }
+    for (i=0; i<numberOfStrips && arraySize>0 && ok; ++i) {
+        ok = writeInt32(stripSizes[i], sink);
+    }
+    return ok && writeInt32(RESOLUTION, sink) && writeInt32(1, sink);
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > PUBLIC FUNCTIONS
+
+Bool writeTiffFromSource(ScanlineSource *source, int numberOfThreads, ByteSink *sink, Bool *out_isTooLarge) {
+    int lineSize, rowsPerStrip, numberOfStrips, numberOfJobs, numberOfBatchJobs, batchLines;
+    int y, i, j, count, strip=0; const Byte *scanline; double fileSize;
+    Byte *lines, *blankLine; long *stripSizes; TiffJob *jobs; ByteSink encoded; Bool ok;
+    assert( source!=NULL );
+    assert( source->width>0 && source->height>0 );
+    assert( source->bitsPerPixel==1 );
+    assert( sink!=NULL );
+    
+    if (out_isTooLarge) { (*out_isTooLarge) = FALSE; }
+    /* the image is processed in batches of one strip per thread */
+    if (numberOfThreads<=0) { numberOfThreads = getNumberOfProcessors(); }
+    numberOfJobs   = numberOfThreads;
+    lineSize       = (source->width+7) / 8;
+    rowsPerStrip   = (int)min(STRIP_SIZE/lineSize, source->height);
+    if (rowsPerStrip<1) { rowsPerStrip=1; }
+    numberOfStrips = (source->height+rowsPerStrip-1) / rowsPerStrip;
+    
+    lines      = malloc((long)numberOfJobs * rowsPerStrip * lineSize);
+    blankLine  = calloc(lineSize, 1);
+    stripSizes = malloc(numberOfStrips * sizeof(long));
+    jobs       = calloc(numberOfJobs, sizeof(TiffJob));
+    ok = lines && blankLine && stripSizes && jobs;
+    if (!ok || !initMemorySink(&encoded)) { free(jobs); free(stripSizes); free(blankLine); free(lines); return FALSE; }
+    
+    for (y=0; y<source->height && ok; y+=batchLines) {
+        
+        /* 1) read the scanlines of the batch */
+        batchLines = min(numberOfJobs*rowsPerStrip, source->height-y);
+        for (i=0; i<batchLines && ok; i+=count) {
+            scanline = readScanlines(source, y+i, &count);
+            if (!scanline) { ok=FALSE; break; }
+            count = min(count, batchLines-i);
+            for (j=0; j<count; ++j) {
+                memcpy(&lines[(long)(i+j)*lineSize], &scanline[(long)j*source->scanlineSize], lineSize);
+            }
+        }
+        if (!ok) { break; }
+        
+        /* 2) encode the strips in parallel */
+        numberOfBatchJobs = (batchLines+rowsPerStrip-1) / rowsPerStrip;
+        for (j=0; j<numberOfBatchJobs; ++j) {
+            jobs[j].lines         = &lines[(long)j*rowsPerStrip*lineSize];
+            jobs[j].blankLine     = blankLine;
+            jobs[j].lineSize      = lineSize;
+            jobs[j].numberOfLines = min(rowsPerStrip, batchLines-j*rowsPerStrip);
+            jobs[j].width         = source->width;
+            ok = initMemorySink(&jobs[j].output) && ok;
+        }
+        if (ok) { runJobs(encodeStrip, jobs, sizeof(TiffJob), numberOfBatchJobs, numberOfThreads); }
+        
+        /* 3) keep the encoded strips until the directory can be written */
+        for (j=0; j<numberOfBatchJobs; ++j) {
+            ok = ok && !jobs[j].hasFailed && writeSinkBytes(&encoded, jobs[j].output.buffer, jobs[j].output.size);
+            if (ok) { stripSizes[strip++] = jobs[j].output.size; }
+            free(jobs[j].output.buffer);
+        }
+    }
+    ok = closeSink(&encoded) && ok;
+    
+    /* the offsets of the format are 32-bit values */
+    fileSize = (double)HEADER_SIZE + DIRECTORY_SIZE + 8.0*numberOfStrips + 8 + encoded.size;
+    if (ok && fileSize>4294967295.0) {
+        if (out_isTooLarge) { (*out_isTooLarge) = TRUE; }
+        ok = FALSE;
+    }
+    ok = ok &&
+         writeDirectory(source, rowsPerStrip, stripSizes, numberOfStrips, sink) &&
+         writeSinkBytes(sink, encoded.buffer, encoded.size);
+    
+    free(encoded.buffer);
+    free(jobs); free(stripSizes); free(blankLine); free(lines);
+    return ok;
+}
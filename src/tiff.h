@@ -0,0 +1,53 @@
+/**
+ * @file       tiff.h
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#ifndef bas2img_tiff_h
+#define bas2img_tiff_h
+#include "globals.h"
+#include "scanline.h"
+#include "sink.h"
+
+
+/**
+ * Writes a bilevel image to a sink using the TIFF format compressed with CCITT Group 4 (T.6)
+ *
+ * The pixels set in the packed 1-bpp scanlines are stored as black and the rest as white.
+ * The image is split in strips of a fixed number of scanlines that are encoded independently,
+ * so the strips are compressed in parallel and the result does not depend on the number of threads.
+ * @param source           The source providing the size and the 1-bpp scanlines of the image
+ * @param numberOfThreads  The number of threads used to compress the image (0 = one per processor)
+ * @param sink             The output sink where the image will be written
+ * @param out_isTooLarge   Pointer to the variable set to TRUE when the compressed image exceeds the 4GB of the format (it can be NULL)
+ */
+Bool writeTiffFromSource(ScanlineSource *source, int numberOfThreads, ByteSink *sink, Bool *out_isTooLarge);
+
+
+#endif /* bas2img_tiff_h */
@@ -0,0 +1,55 @@
+#!/bin/bash
+#  File    : bench-threads.sh
+#  Brief   : Measures the time to render a normal listing and a 100k rows listing with different number of threads
+#  Date    : Oct 18, 2026
+#  Author  : Martin Rizzo | <martinrizzo@gmail.com>
+#  License : MIT (see LICENSE.md)
+#
+#  Usage:  ./bench-threads.sh <path-to-bas2img> [threads...]
+#
+#  The normal listing is the test fixture repeated up to ~1800 rows, the big one contains
+#  100000 short rows (the maximum file size is 1MB). Each case prints the best of 3 runs.
+#  Compare '-t 1' with the other thread counts: with a single processor the extra threads
+#  only show the cost of splitting the image in bands, with several processors the speedup.
+#
+BAS2IMG=$(realpath "${1:?Usage: $0 <path-to-bas2img> [threads...]}")
+shift
+THREADS=${*:-"1 2 4 $(getconf _NPROCESSORS_ONLN)"}
+DATA_DIR=$(dirname "$(realpath "$0")")/data
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+# generate the listings
+for i in $(seq 30); do cat "$DATA_DIR/listing.bas"; done > "$WORK_DIR/normal.bas"
+seq 100000 | sed 's/$/ A\r/' > "$WORK_DIR/rows100k.bas"
+cd "$WORK_DIR" || exit 1
+
+# prints the best time of 3 runs of bas2img with the provided arguments
+best_of_3() {
+    local best='' seconds start end
+    for run in 1 2 3; do
+        start=$(date +%s%N)
+        "$BAS2IMG" msx "$@" >/dev/null 2>&1 || { echo 'error'; return; }
+        end=$(date +%s%N)
+        seconds=$(( (end-start)/1000000 ))
+        if [ -z "$best" ] || [ "$seconds" -lt "$best" ]; then best=$seconds; fi
+    done
+    printf '%d.%03ds' $((best/1000)) $((best%1000))
+}
+
+echo "processors: $(getconf _NPROCESSORS_ONLN)"
+printf '%-28s' 'listing / format'
+for threads in $THREADS; do printf '%10s' "-t $threads"; done
+echo
+for listing in normal.bas rows100k.bas; do
+    # the 100k rows listing is too large for the GIF format
+    if [ $listing = normal.bas ]; then formats=(''); else formats=(); fi
+    for format in "${formats[@]}" -b -P -R -G '-b -s 1.5' '-b -V'; do
+        printf '%-28s' "$listing ${format:--gif}"
+        for threads in $THREADS; do
+            # shellcheck disable=SC2086
+            printf '%10s' "$(best_of_3 $format -t "$threads" "$listing")"
+        done
+        echo
+    done
+done
@@ -0,0 +1,61 @@
+10 REM ======
+20 SCREEN 0:WIDTH 80:COLOR 15,4,4
+30 PRINT "A VERY LONG LINE THAT GOES ON AND ON AND ON AND ON, WELL BEYOND FORTY COLUMNS, TO TEST WRAPPING"
+40 PRINT "CHANGED LINE"
+50 FOR I=1 TO 10:PRINT I:NEXT I
+60 A$="STRING"+B$
+80 IF A>10 THEN PRINT "BIG" ELSE PRINT "SMALL"
+90 PRINT "A VERY LONG LINE THAT GOES ON AND ON AND ON AND ON, WELL BEYOND FORTY COLUMNS, TO TEST WRAPPING"
+100 IF A>10 THEN PRINT "BIG" ELSE PRINT "SMALL"
+110 IF A>10 THEN PRINT "BIG" ELSE PRINT "SMALL"
+105 PRINT "INSERTED"
+120 X=&HFF+&B1010
+130 DATA 1,2,3,4,5,6,7,8,9,10
+140 PRINT "A VERY LONG LINE THAT GOES ON AND ON AND ON AND ON, WELL BEYOND FORTY COLUMNS, TO TEST WRAPPING"
+150 GOTO 20
+160 FOR I=1 TO 10:PRINT I:NEXT I
+170 IF A>10 THEN PRINT "BIG" ELSE PRINT "SMALL"
+180 PRINT "HELLO WORLD"
+190 DATA 1,2,3,4,5,6,7,8,9,10
+200 DATA 1,2,3,4,5,6,7,8,9,10
+210 SCREEN 0:WIDTH 80:COLOR 15,4,4
+220 PRINT "A VERY LONG LINE THAT GOES ON AND ON AND ON AND ON, WELL BEYOND FORTY COLUMNS, TO TEST WRAPPING"
+230 PRINT "A VERY LONG LINE THAT GOES ON AND ON AND ON AND ON, WELL BEYOND FORTY COLUMNS, TO TEST WRAPPING"
+240 PRINT "HELLO WORLD"
+
+260 IF A>10 THEN PRINT "BIG" ELSE PRINT "SMALL"
+270 A$="STRING"+B$
+
+290 PRINT "A VERY LONG LINE THAT GOES ON AND ON AND ON AND ON, WELL BEYOND FORTY COLUMNS, TO TEST WRAPPING"
+300 GOTO 20
+310 SCREEN 0:WIDTH 80:COLOR 15,4,4
+320 FOR I=1 TO 10:PRINT I:NEXT I
+330 X=X+1.5*Y
+340 PRINT "HELLO WORLD"
+350 PRINT "HELLO WORLD"
+360 PRINT "HELLO WORLD"
+370 X=&HFF+&B1010
+380 ' comment line
+390 PRINT "HELLO WORLD"
+400 DATA 1,2,3,4,5,6,7,8,9,10
+410 X=&HFF+&B1010
+420 GOTO 20
+430 DATA 1,2,3,4,5,6,7,8,9,10
+
+450 PRINT "HELLO WORLD"
+460 ' comment line
+470 GOTO 20
+480 PRINT "A VERY LONG LINE THAT GOES ON AND ON AND ON AND ON, WELL BEYOND FORTY COLUMNS, TO TEST WRAPPING"
+490 IF A>10 THEN PRINT "BIG" ELSE PRINT "SMALL"
+500 IF A>10 THEN PRINT "BIG" ELSE PRINT "SMALL"
+510 ' comment line
+520 GOTO 20
+530 X=X+1.5*Y
+540 GOTO 20
+550 X=&HFF+&B1010
+560 GOTO 20
+570 PRINT "A VERY LONG LINE THAT GOES ON AND ON AND ON AND ON, WELL BEYOND FORTY COLUMNS, TO TEST WRAPPING"
+580 IF A>10 THEN PRINT "BIG" ELSE PRINT "SMALL"
+590 A$="STRING"+B$
+600 PRINT "HELLO WORLD"
+999 END
@@ -0,0 +1,152 @@
+/**
+ * @file       test-diff.c
+ * @date       Oct 18, 2026
+ * @author     Martin Rizzo | <martinrizzo@gmail.com>
+ * @copyright  Copyright (c) 2020 Martin Rizzo.
+ *             This project is released under the MIT License.
+ * -------------------------------------------------------------------------
+ *  BAS2IMG - The "source code to image" converter for BASIC language
+ * -------------------------------------------------------------------------
+ *  Copyright (c) 2020 Martin Rizzo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ *  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * -------------------------------------------------------------------------
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "../src/globals.h"
+#include "../src/error.h"
+#include "../src/rows.h"
+#include "../src/diff.h"
+#define RESULT_BUF_SIZE 1024
+
+
+/*=================================================================================================================*/
+#pragma mark - > HELPERS
+
+/**
+ * Decodes a plain text listing, one character per call, where each '|' ends a line
+ */
+static Bool decodeText(Byte **inout_dest, Attr **inout_attr, int *inout_state, const Byte **inout_sour, int sourLen) {
+    const Byte ch = *(*inout_sour)++;
+    if (ch=='|') { return FALSE; }
+    *(*inout_dest)++ = ch;
+    *(*inout_attr)++ = ATTR_PLAIN;
+    return TRUE;
+}
+
+/**
+ * Allocates the rows of a listing written as a single string where each '|' ends a line
+ */
+static Rows allocTextRows(const char *text) {
+    static const SingleRowPtr noRows[1] = { NULL };
+    static const Byte         noMarks[1] = { DIFF_NONE };
+    if (text[0]=='\0') { return allocMarkedRows(noRows, noMarks, 0); }
+    return allocRowsFromBasicBuffer((const Byte*)text, (long)strlen(text), 0, decodeText);
+}
+
+/**
+ * Writes the merged rows into a string where each line is prefixed by its mark
+ * (' ' unchanged, '+' added, '-' removed, '~' changed) and ended by '|'
+ */
+static const char * formatRows(char *buffer, const Rows rows) {
+    static const char prefixes[] = " +-~";
+    char *dest = buffer; int i;
+    for (i=0; rows[i]; ++i) {
+        assert( rows[i]->mark<sizeof(prefixes)-1 );
+        assert( (dest-buffer)+rows[i]->length+3 < RESULT_BUF_SIZE );
+        *dest++ = prefixes[rows[i]->mark];
+        memcpy(dest, rows[i]->chars, rows[i]->length); dest += rows[i]->length;
+        *dest++ = '|';
+    }
+    *dest = '\0';
+    return buffer;
+}
+
+/**
+ * Diffs two listings and compares the merged rows with the expected result
+ * @returns  `TRUE` when the merged rows are the expected ones
+ */
+static Bool testDiff(const char *name, const char *oldText, const char *newText, const char *expected) {
+    char buffer[RESULT_BUF_SIZE]; Rows oldRows, newRows, diffRows; Bool passed;
+    oldRows  = allocTextRows(oldText);
+    newRows  = allocTextRows(newText);
+    diffRows = allocDiffRows(oldRows, newRows);
+    passed   = diffRows!=NULL && strcmp(formatRows(buffer,diffRows), expected)==0;
+    if (!passed) {
+        printf("FAILED: %s\n", name);
+        printf("  expected: \"%s\"\n", expected);
+        printf("  obtained: \"%s\"\n", diffRows ? buffer : "NULL");
+    }
+    freeRows(diffRows);
+    freeRows(newRows);
+    freeRows(oldRows);
+    return passed;
+}
+
+
+/*=================================================================================================================*/
+#pragma mark - > MAIN
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    
+    failed += !testDiff("identical listings",
+                        "10 A|20 B|30 C|", "10 A|20 B|30 C|",
+                        " 10 A| 20 B| 30 C|");
+    failed += !testDiff("both listings empty",
+                        "", "",
+                        "");
+    failed += !testDiff("old listing empty",
+                        "", "10 A|20 B|",
+                        "+10 A|+20 B|");
+    failed += !testDiff("new listing empty",
+                        "10 A|20 B|", "",
+                        "-10 A|-20 B|");
+    failed += !testDiff("added line",
+                        "10 A|30 C|", "10 A|20 B|30 C|",
+                        " 10 A|+20 B| 30 C|");
+    failed += !testDiff("removed line",
+                        "10 A|20 B|30 C|", "10 A|30 C|",
+                        " 10 A|-20 B| 30 C|");
+    failed += !testDiff("changed line",
+                        "10 A|20 B|30 C|", "10 A|20 X|30 C|",
+                        " 10 A|~20 X| 30 C|");
+    failed += !testDiff("changed and added lines",
+                        "10 A|20 B|90 Z|", "10 A|20 X|25 Y|90 Z|",
+                        " 10 A|~20 X|+25 Y| 90 Z|");
+    failed += !testDiff("changed and removed lines",
+                        "10 A|20 B|25 Y|90 Z|", "10 A|20 X|90 Z|",
+                        " 10 A|~20 X|-25 Y| 90 Z|");
+    failed += !testDiff("changed first and last lines",
+                        "10 A|20 B|30 C|", "10 X|20 B|30 Y|",
+                        "~10 X| 20 B|~30 Y|");
+    failed += !testDiff("moved line",
+                        "10 A|20 B|30 C|40 D|", "10 A|30 C|40 D|20 B|",
+                        " 10 A|-20 B| 30 C| 40 D|+20 B|");
+    failed += !testDiff("repeated lines next to an anchor",
+                        "10 A|PRINT|PRINT|20 B|", "10 A|PRINT|PRINT|PRINT|20 B|",
+                        " 10 A| PRINT| PRINT|+PRINT| 20 B|");
+    
+    if (failed>0) { printf("%d diff test(s) failed\n", failed); return 1; }
+    printf("all diff tests passed\n");
+    return 0;
+}
@@ -0,0 +1,319 @@
+#!/usr/bin/env python3
+#  File    : test-formats.py
+#  Brief   : Renders the fixture listings in every format and compares the pixels with the GIF image
+#  Date    : Oct 18, 2026
+#  Author  : Martin Rizzo | <martinrizzo@gmail.com>
+#  License : MIT (see LICENSE.md)
+#
+#  Usage:  python3 test-formats.py <path-to-bas2img>
+#
+#  Each image is decoded and compared pixel by pixel with the GIF image generated with the
+#  same options. BMP, RLE BMP, PNG and SVG must be identical, sixel colors are rounded to
+#  percents (max error of 3) and the bilevel TIFF is compared with the monochrome GIF.
+#  The files generated with different number of threads and CPU tiers must be byte-identical.
+#  Requires Pillow and numpy (the test is skipped when they are not installed).
+#
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import xml.etree.ElementTree as ET
+try:
+    import numpy as np
+    from PIL import Image
+except ImportError:
+    print('SKIPPED: the format tests require Pillow and numpy')
+    sys.exit(0)
+
+DATA_DIR    = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'data')
+LISTING     = 'listing.bas'
+NEW_LISTING = 'listing-new.bas'
+COMPUTER    = 'msx'
+ROW_HEIGHT  = 8     # height of each row of the MSX font in pixels
+PAUSE_DELAY = 2000  # delay of the last frame of each screen of the animation in ms
+
+# format option -> extension of the generated file
+FORMATS = [ ('-b', 'bmp'), ('-R', 'bmp'), ('-P', 'png'), ('-S', 'svg'), ('--sixel', 'six'), ('-G', 'tif') ]
+
+# options that are combined with every format
+OPTIONS = [
+    [],
+    ['-x'],
+    ['-V'],
+    ['-x', '-V', '-w', '-l', '30'],
+    ['-m'],
+    ['-s', '2'],
+    ['-s', '1.5'],
+    ['-p', '4:3'],
+    ['-T'],
+    ['-F', '320x400'],
+]
+
+
+#=========================================================================================================
+# > RUNNING BAS2IMG
+
+class TestFailure(Exception):
+    pass
+
+def run(args, stdout=None):
+    """Runs bas2img with the provided arguments raising TestFailure on error"""
+    result = subprocess.run([BAS2IMG] + args, stdout=stdout or subprocess.DEVNULL, stderr=subprocess.PIPE)
+    if result.returncode != 0:
+        raise TestFailure('bas2img %s: %s' % (' '.join(args), result.stderr.decode(errors='replace').strip()))
+    return result.stdout
+
+def render(options, formatOption=None, listings=(LISTING,), name=None):
+    """Renders the listing(s) and returns the list of generated files renamed to `name`"""
+    extension   = dict(FORMATS).get(formatOption, 'gif') if formatOption != '-A' else 'gif'
+    args        = ([formatOption] if formatOption else []) + options
+    isDiff      = len(listings) > 1
+    basename    = os.path.splitext(listings[-1])[0]
+    if formatOption == '--sixel':
+        # a single image is written to stdout, the pages are written to numbered files
+        output = run((['diff'] if isDiff else []) + [COMPUTER] + args + list(listings), subprocess.PIPE)
+        if output.startswith(b'\x1bP'):
+            with open(basename + '.six', 'wb') as file:
+                file.write(output)
+    else:
+        run((['diff'] if isDiff else []) + [COMPUTER] + args + list(listings))
+    pattern = re.compile(re.escape(basename) + r'(-\d+)?\.' + extension + '$')
+    files   = sorted(f for f in os.listdir('.') if pattern.match(f))
+    if not files:
+        raise TestFailure('bas2img %s did not generate any .%s file' % (' '.join(args), extension))
+    renamed = []
+    for file in files:
+        renamed.append((name or 'out') + file[len(basename):])
+        os.replace(file, renamed[-1])
+    return renamed
+
+
+#=========================================================================================================
+# > DECODERS
+
+def decodeImage(path):
+    """Decodes a BMP, PNG or GIF image to an array of RGB pixels"""
+    return np.array(Image.open(path).convert('RGB'))
+
+def decodeSixel(path):
+    """Decodes the DEC sixel data written by bas2img to an array of RGB pixels"""
+    data = open(path, 'rb').read().decode('latin1')
+    if not data.startswith('\x1bP') or not data.endswith('\x1b\\'):
+        raise TestFailure('%s is not enclosed in DCS .. ST' % path)
+    body  = data[data.index('q')+1:-2]
+    match = re.match(r'"1;1;(\d+);(\d+)', body)
+    width, height = int(match.group(1)), int(match.group(2))
+    body  = body[match.end():]
+    image = np.zeros(((height+5)//6*6, width, 3), np.uint8)
+    palette, color, x, y, i = {}, None, 0, 0, 0
+    colorCommand  = re.compile(r'#(\d+)(;2;(\d+);(\d+);(\d+))?')
+    repeatCommand = re.compile(r'!(\d+)')
+    while i < len(body):
+        char = body[i]
+        if char == '#':
+            match = colorCommand.match(body, i); i = match.end()
+            if match.group(2): palette[int(match.group(1))] = tuple(round(int(v)*255/100) for v in match.group(3, 4, 5))
+            else:              color = palette[int(match.group(1))]
+            continue
+        if char == '$': x = 0;       i += 1; continue
+        if char == '-': x = 0; y += 6; i += 1; continue
+        count = 1
+        if char == '!':
+            match = repeatCommand.match(body, i); count = int(match.group(1)); i = match.end(); char = body[i]
+        bits = ord(char) - 63
+        for bit in range(6):
+            if bits >> bit & 1: image[y+bit, x:x+count] = color
+        x += count; i += 1
+    return image[:height]
+
+def decodeSvg(path):
+    """Rasterizes the rectangles, glyph paths and glyph references of the SVG written by bas2img"""
+    svgNs, xlinkHref = '{http://www.w3.org/2000/svg}', '{http://www.w3.org/1999/xlink}href'
+    root  = ET.parse(path).getroot()
+    _, _, width, height = [int(float(v)) for v in root.get('viewBox').split()]
+    image = np.zeros((height, width, 3), np.uint8)
+    ids   = { e.get('id'): e for e in root.iter() if e.get('id') }
+    def multiply(a, b):
+        return (a[0]*b[0]+a[2]*b[1], a[1]*b[0]+a[3]*b[1], a[0]*b[2]+a[2]*b[3], a[1]*b[2]+a[3]*b[3],
+                a[0]*b[4]+a[2]*b[5]+a[4], a[1]*b[4]+a[3]*b[5]+a[5])
+    def parseTransform(text):
+        matrix = (1, 0, 0, 1, 0, 0)
+        for name, args in re.findall(r'(\w+)\(([^)]*)\)', text or ''):
+            values = [float(v) for v in re.split('[ ,]+', args.strip())]
+            if name == 'translate': matrix = multiply(matrix, (1, 0, 0, 1, values[0], values[1] if len(values) > 1 else 0))
+            elif name == 'rotate' and values[0] == 90: matrix = multiply(matrix, (0, 1, -1, 0, 0, 0))
+            else: raise TestFailure('unsupported SVG transform: %s' % name)
+        return matrix
+    def fillRect(matrix, x, y, w, h, color):
+        xs = sorted(matrix[0]*px + matrix[2]*py + matrix[4] for px, py in ((x, y), (x+w, y+h)))
+        ys = sorted(matrix[1]*px + matrix[3]*py + matrix[5] for px, py in ((x, y), (x+w, y+h)))
+        image[int(round(ys[0])):int(round(ys[1])), int(round(xs[0])):int(round(xs[1]))] = color
+    def draw(element, matrix, color):
+        tag = element.tag.replace(svgNs, '')
+        if element.get('fill'):
+            fill  = element.get('fill')
+            color = (int(fill[1:3], 16), int(fill[3:5], 16), int(fill[5:7], 16))
+        if tag in ('svg', 'g', 'symbol'):
+            matrix = multiply(matrix, parseTransform(element.get('transform')))
+            for child in element:
+                if child.tag.replace(svgNs, '') != 'defs': draw(child, matrix, color)
+        elif tag == 'rect':
+            fillRect(matrix, float(element.get('x', 0)), float(element.get('y', 0)),
+                     float(element.get('width')), float(element.get('height')), color)
+        elif tag == 'path':
+            for x, y, w, h in re.findall(r'M(\d+) (\d+)h(\d+)v(\d+)h-\d+z', element.get('d')):
+                fillRect(matrix, int(x), int(y), int(w), int(h), color)
+        elif tag == 'use':
+            matrix = multiply(matrix, (1, 0, 0, 1, float(element.get('x', 0)), float(element.get('y', 0))))
+            draw(ids[element.get(xlinkHref)[1:]], matrix, color)
+    draw(root, (1, 0, 0, 1, 0, 0), (0, 0, 0))
+    return image
+
+
+#=========================================================================================================
+# > COMPARISONS
+
+def compareWithGif(path, gifPath, formatOption):
+    """Compares the pixels of the image generated in a format with the pixels of the GIF image"""
+    gif = decodeImage(gifPath)
+    if formatOption == '-G':
+        tiff = Image.open(path)
+        if tiff.info.get('compression') != 'group4':
+            raise TestFailure('%s is not compressed with CCITT G4' % path)
+        # the text is drawn in black, the background is the first color of the monochrome GIF
+        text     = np.array(Image.open(gifPath)) != 0
+        pixels   = np.array(tiff.convert('L')) == 0
+        tolerance, difference = 0, None if pixels.shape != text.shape else (pixels != text)
+    else:
+        pixels    = decodeSvg(path) if formatOption == '-S' else decodeSixel(path) if formatOption == '--sixel' else decodeImage(path)
+        tolerance = 3 if formatOption == '--sixel' else 0
+        difference = None if pixels.shape != gif.shape else \
+                     np.abs(pixels.astype(int) - gif.astype(int)).max(axis=2) > tolerance
+    if difference is None:
+        raise TestFailure('%s has a different size than %s' % (path, gifPath))
+    if difference.any():
+        raise TestFailure('%s has %d pixels different from %s' % (path, difference.sum(), gifPath))
+
+def compareSvgSize(path, gifPath):
+    """Verifies that the size declared by the SVG image is the size of the GIF image"""
+    root, gif = ET.parse(path).getroot(), Image.open(gifPath)
+    if (int(root.get('width')), int(root.get('height'))) != gif.size:
+        raise TestFailure('%s declares a size of %sx%s, %dx%d was expected' %
+                          (path, root.get('width'), root.get('height'), gif.size[0], gif.size[1]))
+
+def compareBytes(path1, path2):
+    """Verifies that two generated files are byte-identical"""
+    if open(path1, 'rb').read() != open(path2, 'rb').read():
+        raise TestFailure('%s and %s are not identical' % (path1, path2))
+
+def checkAnimation(path, stillPath):
+    """Verifies that the animation reveals the still image row by row in screens as high as each frame"""
+    animation, still = Image.open(path), decodeImage(stillPath)
+    width, screenHeight = animation.size
+    frame, pageTop = 0, 0
+    while pageTop < still.shape[0]:
+        pageBottom = min(pageTop + screenHeight, still.shape[0])
+        y = pageTop
+        while y < pageBottom:
+            y = min(y + ROW_HEIGHT, pageBottom)
+            animation.seek(frame)
+            pixels = np.array(animation.convert('RGB'))
+            if pixels.shape[1] != still.shape[1] or (pixels[:y-pageTop] != still[pageTop:y]).any():
+                raise TestFailure('frame %d of %s does not match the rows %d..%d of %s' % (frame, path, pageTop, y, stillPath))
+            if (animation.info.get('duration') == PAUSE_DELAY) != (y == pageBottom):
+                raise TestFailure('frame %d of %s has a wrong delay' % (frame, path))
+            frame += 1
+        pageTop = pageBottom
+    if frame != animation.n_frames:
+        raise TestFailure('%s contains %d frames, %d were expected' % (path, animation.n_frames, frame))
+
+
+#=========================================================================================================
+# > TESTS
+
+def removeOptions(options, names):
+    """Returns the options without the provided ones (and their values)"""
+    result, i = [], 0
+    while i < len(options):
+        if   options[i] == '-T':  i += 1
+        elif options[i] in names: i += 2
+        else: result.append(options[i]); i += 1
+    return result if '-T' in names else result + (['-T'] if '-T' in options else [])
+
+def testFormats(options, listings=(LISTING,)):
+    """Renders the listing with the options in every format and compares each image with the GIF"""
+    gifs = render(options, None, listings, 'ref')
+    for formatOption, extension in FORMATS:
+        if formatOption == '-S':
+            # the glyphs of the SVG are not resampled, the scale only changes the declared size
+            refs  = render(removeOptions(options, ('-s', '-p', '-T')), None, listings, 'vector')
+            sizes = render(removeOptions(options, ('-T',)), None, listings, 'size') if '-T' in options else gifs
+        else:
+            refs  = gifs if formatOption != '-G' else render(options + ['-m'], None, listings, 'mono')
+            sizes = refs
+        files = render(options, formatOption, listings, 'test')
+        if len(files) != len(refs):
+            raise TestFailure('%s generated %d images, %d were expected' % (formatOption, len(files), len(refs)))
+        for path, ref, sizeRef in zip(files, refs, sizes):
+            compareWithGif(path, ref, formatOption)
+            if formatOption == '-S':
+                compareSvgSize(path, sizeRef)
+
+def testDeterminism(options):
+    """Verifies that every format is byte-identical with any number of threads and any CPU tier"""
+    for formatOption, extension in [(None, 'gif')] + FORMATS:
+        ref = render(options + ['-t', '1', '--cpu=generic'], formatOption, name='ref')
+        for variant in (['-t', '3', '--cpu=generic'], ['-t', '1', '--cpu=sse2'], ['-t', '4', '--cpu=avx2']):
+            for path, refPath in zip(render(options + variant, formatOption, name='test'), ref):
+                compareBytes(path, refPath)
+
+def testAnimation(options):
+    """Verifies the scrolling animation against the still GIF image"""
+    still = render(options, None, name='still')[0]
+    checkAnimation(render(options + ['-A', '10'], '-A', name='anim')[0], still)
+
+def main():
+    tests = []
+    for options in OPTIONS:
+        tests.append(('formats %s' % ' '.join(options), testFormats, (options,)))
+    tests.append(('formats -r 20'       , testFormats, (['-r', '20'],)))
+    tests.append(('formats diff'        , testFormats, ([], (LISTING, NEW_LISTING))))
+    tests.append(('formats diff -V -x'  , testFormats, (['-V', '-x'], (LISTING, NEW_LISTING))))
+    tests.append(('threads and cpu'     , testDeterminism, ([],)))
+    tests.append(('threads and cpu -x -s 1.5', testDeterminism, (['-x', '-s', '1.5'],)))
+    tests.append(('animation'           , testAnimation, ([],)))
+    tests.append(('animation -x -w -l 30', testAnimation, (['-x', '-w', '-l', '30'],)))
+
+    failed = 0
+    workDir = tempfile.mkdtemp(prefix='bas2img-test-')
+    try:
+        for name, test, args in tests:
+            testDir = os.path.join(workDir, str(len(os.listdir(workDir))))
+            os.mkdir(testDir)
+            for listing in (LISTING, NEW_LISTING):
+                shutil.copy(os.path.join(DATA_DIR, listing), testDir)
+            os.chdir(testDir)
+            try:
+                test(*args)
+            except TestFailure as failure:
+                print('FAILED: %s\n  %s' % (name, failure))
+                failed += 1
+    finally:
+        os.chdir(DATA_DIR)
+        shutil.rmtree(workDir)
+
+    if failed > 0:
+        print('%d format test(s) failed' % failed)
+        return 1
+    print('all format tests passed')
+    return 0
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print('Usage: python3 %s <path-to-bas2img>' % os.path.basename(sys.argv[0]))
+        sys.exit(2)
+    BAS2IMG = os.path.abspath(sys.argv[1])
+    sys.exit(main())